@@ -1,52 +1,88 @@
 #include "block_handle.h"
 
-BlockHandle::~BlockHandle() {
-  BlockInfo *p = first_block_;
-  while (bcount_ > 0) {
-    BlockInfo *pn = p->next();
-    delete p;
-    p = pn;
-    bcount_--;
+#include <sys/mman.h>
+
+#include <new>
+
+BlockHandle::BlockHandle(std::string p, int bsize, int page_size, int shards,
+                         bool huge_pages)
+    : arena_(NULL), arena_bytes_(0), huge_pages_(false), frames_(NULL),
+      first_blocks_(shards, (BlockInfo *)NULL), shard_sizes_(shards, 0),
+      bcounts_(shards, 0), bsize_(bsize), page_size_(page_size), path_(p) {
+  AllocateArena(huge_pages);
+  frames_ = new BlockInfo[bsize_];
+  for (int s = 0; s < shards; ++s) {
+    int first = (long)bsize_ * s / shards;
+    int last = (long)bsize_ * (s + 1) / shards;
+    for (int i = last - 1; i >= first; --i) {
+      frames_[i].set_frame(arena_ + (long)i * page_size_);
+      frames_[i].set_size(page_size_);
+      frames_[i].set_shard(s);
+      frames_[i].set_next(first_blocks_[s]);
+      first_blocks_[s] = &frames_[i];
+    }
+    shard_sizes_[s] = bcounts_[s] = last - first;
   }
 }
 
-// Initiate 301 new BlockInfo(0) and return the last new BlockInfo(0) block
-// first_block_ new BlockInfo(0) will never be used
-// Note: new BlockInfo(0) will have block number 0
-BlockInfo *BlockHandle::Add(BlockInfo *block) {
-  BlockInfo *adder = new BlockInfo(0);
-  adder->set_next(block->next());
-  block->set_next(adder);
-  bcount_++;
-  if (bcount_ == bsize_) {
-    return adder;
-  } else {
-    return Add(adder);
+BlockHandle::~BlockHandle() {
+  delete[] frames_;
+  munmap(arena_, arena_bytes_);
+}
+
+// One anonymous mapping is page aligned, so every block is aligned for O_DIRECT as well
+// Huge pages are tried first if asked for, then transparent huge pages are requested for a normal mapping
+void BlockHandle::AllocateArena(bool huge_pages) {
+  long bytes = (long)bsize_ * page_size_;
+  void *p = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+  if (huge_pages) {
+    long huge_page = 2 * 1024 * 1024;
+    long huge_bytes = (bytes + huge_page - 1) / huge_page * huge_page;
+    p = mmap(NULL, huge_bytes, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p != MAP_FAILED) {
+      bytes = huge_bytes;
+      huge_pages_ = true;
+    }
+  }
+#endif
+
+  if (p == MAP_FAILED) {
+    p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+             -1, 0);
+    if (p == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+#ifdef MADV_HUGEPAGE
+    if (huge_pages) {
+      madvise(p, bytes, MADV_HUGEPAGE);
+    }
+#endif
   }
+
+  arena_ = (char *)p;
+  arena_bytes_ = bytes;
 }
 
-// Pop and get the empty block which lines up immediately after first_block_
-BlockInfo *BlockHandle::GetUsableBlock() {
-  if (bcount_ == 0) {
+// Pop and get the first empty block of the shard
+BlockInfo *BlockHandle::GetUsableBlock(int shard) {
+  if (bcounts_[shard] == 0) {
     return NULL;
   }
 
-  BlockInfo *p = first_block_->next();
-  first_block_->set_next(first_block_->next()->next());
-  bcount_--;
-  p->ResetAge();
+  BlockInfo *p = first_blocks_[shard];
+  first_blocks_[shard] = p->next();
+  bcounts_[shard]--;
   p->set_next(NULL);
   return p;
 }
 
-// Put back an empty block after first_block_
+// Put back an empty block to its shard
 void BlockHandle::FreeBlock(BlockInfo *block) {
-  if (bcount_ == 0) {
-    first_block_ = block;
-    block->set_next(block);
-  } else {
-    block->set_next(first_block_->next());
-    first_block_->set_next(block);
-  }
-  bcount_++;
-}
\ No newline at end of file
+  int shard = block->shard();
+  block->set_next(first_blocks_[shard]);
+  first_blocks_[shard] = block;
+  bcounts_[shard]++;
+}
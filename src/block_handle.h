@@ -1,44 +1,50 @@
 #ifndef MINIDB_BLOCK_HANDLE_H_
 #define MINIDB_BLOCK_HANDLE_H_
 
+#include <vector>
+
 #include "block_info.h"
 
-// The purpose of block_handle is to provide a total of 300 empty blocks for the purpose of buffer. 
+// The purpose of block_handle is to provide a total of bsize_ (300 by default) empty blocks for the purpose of buffer. 
 // Each time when the file_handle needs to use a block
 // if there are still empty blocks remaining, the file_handle will take an empty block from block_handle
-// if there are no empty blocks remaining, then file_handle will recycle its own oldest block
+// if there are no empty blocks remaining, then file_handle will recycle the block chosen by its replacer
 // once a block is free, file_handle will then put back an empty block into block_handle
+//
+// The data of all blocks is carved from one page aligned arena (backed by huge pages if asked for),
+// and the BlockInfo of block i is frames_[i], which owns the page_size_ bytes at arena_ + i * page_size_
+// The blocks are split into contiguous ranges, one for each shard of the buffer, and every shard has its own
+// list of empty blocks, which is only used under the latch of that shard
 class BlockHandle {
 private:
-  BlockInfo *first_block_;
+  char *arena_;
+  long arena_bytes_;
+  bool huge_pages_;    // arena_ is a MAP_HUGETLB mapping
+  BlockInfo *frames_;  // dense array of bsize_ blocks
+  std::vector<BlockInfo *> first_blocks_; // first empty block of every shard, the empty blocks are linked through next()
+  std::vector<int> shard_sizes_; // total # of every shard
+  std::vector<int> bcounts_;     // usable # of every shard
   int bsize_;  // total #
-  int bcount_; // usable #
+  int page_size_;
   std::string path_;
 
-  // Inits BlockHandle
-  BlockInfo *Add(BlockInfo *block);
-  // Initiate 301 new BlockInfo(0) and return the last new BlockInfo(0) block
-  // first_block_ new BlockInfo(0) will never be used
-  // Note: new BlockInfo(0) will have block number 0
+  void AllocateArena(bool huge_pages);
 
 public:
-  BlockHandle(std::string p)
-      : first_block_(new BlockInfo(0)), bsize_(300), bcount_(0), path_(p) {
-    Add(first_block_);
-  }
-
-  BlockHandle(std::string p, int bsize)
-      : first_block_(new BlockInfo(0)), bsize_(bsize), bcount_(0), path_(p) {
-    Add(first_block_);
-  }
-
+  BlockHandle(std::string p, int bsize, int page_size, int shards, bool huge_pages);
   ~BlockHandle();
 
-  int bcount() { return bcount_; }
+  int bsize() { return bsize_; }
+  int page_size() { return page_size_; }
+  int shards() { return shard_sizes_.size(); }
+  int shard_size(int shard) { return shard_sizes_[shard]; }
+  int bcount(int shard) { return bcounts_[shard]; }
+  long arena_bytes() { return arena_bytes_; }
+  bool huge_pages() { return huge_pages_; }
 
-  BlockInfo *GetUsableBlock(); // Pop and get the empty block which lines up immediately after first_block_
+  BlockInfo *GetUsableBlock(int shard); // Pop and get the first empty block of the shard
 
-  void FreeBlock(BlockInfo *block); // Put back an empty block after first_block_
+  void FreeBlock(BlockInfo *block); // Put back an empty block to its shard
 
   // Stack data structure
 };
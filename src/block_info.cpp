@@ -1,37 +1,74 @@
 #include "block_info.h"
 
-#include <fstream>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <iostream>
 
 #include "commons.h"
 
 using namespace std;
 
-void BlockInfo::ReadInfo(std::string path) {
-  path += file_->db_name() + "/" + file_->file_name();
-
-  if (file_->type() == FORMAT_INDEX) {
-    path += ".index";
-  } else {
-    path += ".records";
+void BlockInfo::ReadInfo() {
+  if (mapped()) {
+    return;
+  }
+  ssize_t n = pread(file_->fd(), data_, size_, (off_t)block_num_ * size_);
+  if (n < 0) {
+    cerr << "Failed to read block " << block_num_ << " of " << file_->file_name() << endl;
+    n = 0;
   }
+  if (n < size_) {
+    memset(data_ + n, 0, size_ - n);
+  }
+}
 
-  ifstream ifs(path, ios::binary);
-  ifs.seekg(block_num_ * 4 * 1024);
-  ifs.read(data_, 4 * 1024);
-  ifs.close();
+void BlockInfo::WriteInfo() {
+  if (mapped()) {
+    if (msync(data_, size_, MS_ASYNC) == -1) {
+      cerr << "Failed to sync block " << block_num_ << " of " << file_->file_name() << endl;
+    }
+    return;
+  }
+  ssize_t n = pwrite(file_->fd(), data_, size_, (off_t)block_num_ * size_);
+  if (n != size_) {
+    cerr << "Failed to write block " << block_num_ << " of " << file_->file_name() << endl;
+  }
 }
 
-void BlockInfo::WriteInfo(std::string path) {
-  path += file_->db_name() + "/" + file_->file_name();
+void BlockInfo::WriteRun(std::vector<BlockInfo *> &run) {
+  if (run.size() == 1) {
+    run[0]->WriteInfo();
+    return;
+  }
 
-  if (file_->type() == FORMAT_INDEX) {
-    path += ".index";
-  } else {
-    path += ".records";
+  if (run[0]->mapped()) { // consecutive blocks are next to each other in the mapping as well
+    char *end = run[0]->data_;
+    for (unsigned int i = 0; i < run.size() && run[i]->data_ == end; ++i) {
+      end += run[i]->size_;
+    }
+    if (end == run[0]->data_ + run.size() * run[0]->size_ &&
+        msync(run[0]->data_, end - run[0]->data_, MS_ASYNC) == 0) {
+      return;
+    }
+    for (unsigned int i = 0; i < run.size(); ++i) {
+      run[i]->WriteInfo();
+    }
+    return;
   }
 
-  ofstream ofs(path, ios::binary);
-  ofs.seekp(block_num_ * 4 * 1024);
-  ofs.write(data_, 4 * 1024);
-  ofs.close();
-}
\ No newline at end of file
+  vector<struct iovec> iov(run.size());
+  for (unsigned int i = 0; i < run.size(); ++i) {
+    iov[i].iov_base = run[i]->data_;
+    iov[i].iov_len = run[i]->size_;
+  }
+  ssize_t n = pwritev(run[0]->file_->fd(), &iov[0], iov.size(),
+                      (off_t)run[0]->block_num_ * run[0]->size_);
+  if (n != (ssize_t)run.size() * run[0]->size_) { // write them one by one, which reports the failing block
+    for (unsigned int i = 0; i < run.size(); ++i) {
+      run[i]->WriteInfo();
+    }
+  }
+}
@@ -3,6 +3,8 @@
 
 #include <sys/types.h>
 
+#include <vector>
+
 #include "commons.h"
 #include "file_info.h"
 
@@ -10,23 +12,34 @@ class BlockInfo {
 private:
   FileInfo *file_;
   int block_num_;
-  char *data_;
+  char *data_;    // frame_, or the block in the mapping of the file in mmap storage
+  char *frame_;
+  int size_;      // page size of the database
   bool dirty_;
-  long age_;
+  int pin_count_; // a pinned block is never recycled
+  int shard_;     // the shard of the buffer the block belongs to
   BlockInfo *next_;
 
+  // bookkeeping of the replacer, see replacer.h
+  BlockInfo *lru_prev_;
+  BlockInfo *lru_next_;
+  bool referenced_;
+  int clock_slot_;
+  bool hot_;
+
 public:
-  BlockInfo(int num) // input block number
-      : dirty_(false), next_(NULL), file_(NULL), age_(0), block_num_(num) {
-    data_ = new char[4 * 1024];
-  }
+  // The size_ bytes of frame_ belong to the arena of block_handle
+  BlockInfo()
+      : dirty_(false), pin_count_(0), shard_(0), next_(NULL), file_(NULL), block_num_(0),
+        data_(NULL), frame_(NULL), size_(PAGE_SIZE_DEFAULT), lru_prev_(NULL), lru_next_(NULL), referenced_(false),
+        clock_slot_(-1), hot_(false) {}
 
   // byte index 0-3 record previous block number, 
   // byte index 4-7 record next block number
   // byte index 8-11 record record count, which means number of rows of the table contained in this block
   // byte index 12 onwards, record content
 
-  virtual ~BlockInfo() { delete[] data_; }
+  ~BlockInfo() {}
   FileInfo *file() { return file_; }
   void set_file(FileInfo *f) { file_ = f; }
 
@@ -34,17 +47,44 @@ public:
   void set_block_num(int num) { block_num_ = num; }
 
   char *data() { return data_; }
+  void set_frame(char *frame) { data_ = frame_ = frame; }
+
+  // In mmap storage data_ points into the mapping of the file and nothing is copied, see FileTable::MapBlock
+  bool mapped() { return data_ != frame_; }
+  void Map(char *data) { data_ = data; }
+  void Unmap() { data_ = frame_; }
 
-  long age() { return age_; }
+  int size() { return size_; }
+  void set_size(int size) { size_ = size; }
+
+  int shard() { return shard_; }
+  void set_shard(int shard) { shard_ = shard; }
 
   bool dirty() { return dirty_; }
-  void set_dirty(bool dt) { dirty_ = true; }
+  void set_dirty(bool dt) { dirty_ = dt; }
+
+  int pin_count() { return pin_count_; }
+  bool pinned() { return pin_count_ > 0; }
+  void Pin() { ++pin_count_; }
+  void Unpin() { --pin_count_; }
 
   BlockInfo *next() { return next_; }
   void set_next(BlockInfo *block) { next_ = block; }
 
-  void IncreaseAge() { ++age_; }
-  void ResetAge() { age_ = 0; }
+  BlockInfo *lru_prev() { return lru_prev_; }
+  void set_lru_prev(BlockInfo *block) { lru_prev_ = block; }
+
+  BlockInfo *lru_next() { return lru_next_; }
+  void set_lru_next(BlockInfo *block) { lru_next_ = block; }
+
+  bool referenced() { return referenced_; }
+  void set_referenced(bool ref) { referenced_ = ref; }
+
+  int clock_slot() { return clock_slot_; }
+  void set_clock_slot(int slot) { clock_slot_ = slot; }
+
+  bool hot() { return hot_; } // in the Am queue of the 2Q replacer
+  void set_hot(bool hot) { hot_ = hot; }
 
   void SetPrevBlockNum(int num) { *(int *)(data_) = num; }
 
@@ -62,8 +102,11 @@ public:
 
   char *GetContentAddress() { return data_ + 12; } // byte index 12 onwards, record content
 
-  void ReadInfo(std::string path);
-  void WriteInfo(std::string path);
+  // One pread/pwrite on the descriptor kept in file_, reading past the end of the file gives a zeroed block
+  // A mapped block is not read, and writing it only starts the writeback of the mapping with msync
+  void ReadInfo();
+  void WriteInfo();
+  static void WriteRun(std::vector<BlockInfo *> &run); // Consecutive blocks of one file, written with one pwritev
 };
 
 #endif /* MINIDB_BLOCK_INFO_H_ */
@@ -1,61 +1,444 @@
 #include "buffer_manager.h"
 
+#include <limits.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <fstream>
+#include <iomanip>
+#include <iostream>
 
 #include "commons.h"
+#include "exceptions.h"
 
 #include "file_info.h"
 
 using namespace std;
 
+BufferManager::BufferManager(string p, BufferOptions options, int page_size)
+    : bhandle_(NULL), ftable_(new FileTable(p, page_size)), path_(p), options_(options),
+      page_size_(page_size),
+      stop_writer_(false), wake_writer_(false) {
+  // one shard per core unless asked for, but never shards smaller than MIN_POOL_PAGES
+  int shards = options_.shards;
+  if (shards <= 0) {
+    shards = min((int)thread::hardware_concurrency(),
+                 options_.pool_pages / SHARD_AUTO_PAGES);
+  }
+  shards = min(shards, options_.pool_pages / MIN_POOL_PAGES);
+  if (shards < 1) {
+    shards = 1;
+  }
+  options_.shards = shards;
+
+  bhandle_ = new BlockHandle(p, options_.pool_pages, page_size_, shards,
+                             options_.huge_pages);
+  for (int i = 0; i < shards; ++i) {
+    shards_.push_back(new FileHandle(ftable_, options_.replacer, options_.io));
+  }
+  if (options_.flush_interval_ms > 0) {
+    writer_ = thread(&BufferManager::WriterLoop, this);
+  }
+}
+
+BufferManager::~BufferManager() {
+  if (writer_.joinable()) {
+    {
+      lock_guard<mutex> lock(writer_latch_);
+      stop_writer_ = true;
+    }
+    writer_cv_.notify_one();
+    writer_.join();
+  }
+  for (unsigned int i = 0; i < shards_.size(); ++i) {
+    delete shards_[i]; // writes back the blocks, so before the files are closed and the arena is unmapped
+  }
+  if (options_.storage == STORAGE_MMAP) {
+    ftable_->Sync();
+  }
+  delete ftable_;
+  delete bhandle_;
+}
+
+// Fibonacci hashing of the page key of the extent the block is in
+int BufferManager::ShardOf(int file_id, int block_num) {
+  if (shards_.size() == 1) {
+    return 0;
+  }
+  unsigned long long h =
+      (unsigned long long)FileHandle::PageKey(file_id, block_num / SHARD_EXTENT_PAGES) *
+      0x9E3779B97F4A7C15ULL;
+  return (h >> 32) % shards_.size();
+}
+
+int BufferManager::GetFileId(string db_name, string tb_name, int file_type) {
+  return ftable_->GetFileId(db_name, tb_name, file_type);
+}
+
+BlockInfo *BufferManager::GetFileBlock(int file_id, int block_num) {
+  int shard = ShardOf(file_id, block_num);
+  lock_guard<mutex> lock(shards_[shard]->latch());
+  return FetchBlock(shard, file_id, block_num);
+}
+
+BlockInfo *BufferManager::FetchBlock(int shard, int file_id, int block_num) {
+  // remember the shard is the container of all blocks that are currently in use and hash to it
+  FileHandle *fhandle = shards_[shard];
+  BlockInfo *block = fhandle->GetBlockInfo(file_id, block_num);
+  int low, high;
+  bool read_ahead = ftable_->ReadAhead(file_id, block_num, block == NULL,
+                                       options_.read_ahead_pages, &low, &high);
+  // if the shard contains the block of which the file id and block_num matches with what you need
+  FileInfo *fp = ftable_->GetFileInfo(file_id);
+  if (block) {
+    BufferStats::Add(ftable_->stats().hits, 1);
+    BufferStats::Add(fp->stats().hits, 1);
+    return block;
+  }
+  BufferStats::Add(ftable_->stats().misses, 1);
+  BufferStats::Add(fp->stats().misses, 1);
+
+  // else, get one block of the shard either from bhandle_ (empty block) or from the shard (recycled block)
+  // then set the block to what you need
+  // and add it back to the shard
+  BlockInfo *bp = GetUsableBlock(shard);
+  bp->set_block_num(block_num);
+  bp->set_file(fp);
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  bp->Unmap();
+  if (options_.storage == STORAGE_MMAP) {
+    char *data = ftable_->MapBlock(file_id, block_num);
+    if (data != NULL) {
+      bp->Map(data);
+    }
+  }
+  if (read_ahead && !bp->mapped() && fhandle->io()->batched()) {
+    ReadBatch(shard, bp, low, high);
+  } else {
+    bp->ReadInfo();
+  }
+  long ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+  BufferStats::Add(ftable_->stats().read_ns, ns);
+  BufferStats::Add(fp->stats().read_ns, ns);
+  fhandle->AddBlockInfo(bp);
+  return bp;
+}
+
+void BufferManager::ReadAheadDone(IORequest &req, void *arg) {
+  BufferManager *manager = (BufferManager *)arg;
+  for (unsigned int i = 0; i < req.blocks.size(); ++i) {
+    manager->shards_[req.blocks[i]->shard()]->AddBlockInfo(req.blocks[i]);
+  }
+}
+
+// The missed block bp and the blocks [low, high] read ahead go to the I/O backend of the shard as one batch,
+// which reads the blocks read ahead into the buffer, so the scan finds them there.
+// The latches of the other shards are only tried, and a shard that is busy is left out, so they are never
+// waited for in the wrong order. No shard gives more than a quarter of its blocks to one read ahead
+void BufferManager::ReadBatch(int shard, BlockInfo *bp, int low, int high) {
+  vector<IORequest> batch;
+  batch.push_back(IORequest(IO_OP_READ, NULL, NULL));
+  batch.back().blocks.push_back(bp);
+
+  vector<int> latched(shards_.size(), 0); // 1 if latched here, -1 if busy
+  vector<int> budget(shards_.size());
+  for (unsigned int i = 0; i < shards_.size(); ++i) {
+    budget[i] = bhandle_->shard_size(i) / 4;
+  }
+  latched[shard] = 2; // by the caller
+
+  int file_id = bp->file()->file_id();
+  for (int num = low; num <= high; ++num) {
+    int s = ShardOf(file_id, num);
+    if (latched[s] == 0) {
+      latched[s] = shards_[s]->latch().try_lock() ? 1 : -1;
+    }
+    if (num == bp->block_num() || latched[s] < 0 || budget[s] == 0 ||
+        shards_[s]->HasBlock(file_id, num)) {
+      continue;
+    }
+    BlockInfo *block = bhandle_->GetUsableBlock(s);
+    if (block == NULL) {
+      block = shards_[s]->RecycleBlock();
+    }
+    if (block == NULL) { // every block of the shard is pinned
+      budget[s] = 0;
+      continue;
+    }
+    budget[s]--;
+    block->set_file(bp->file());
+    block->set_block_num(num);
+    block->Unmap();
+
+    IORequest &last = batch.back();
+    if (last.done != ReadAheadDone || last.blocks.back()->block_num() != num - 1 ||
+        last.blocks.size() == IOV_MAX) {
+      batch.push_back(IORequest(IO_OP_READ, ReadAheadDone, this));
+    }
+    batch.back().blocks.push_back(block);
+  }
+
+  shards_[shard]->io()->Submit(batch);
+  for (unsigned int i = 0; i < shards_.size(); ++i) {
+    if (latched[i] == 1) {
+      shards_[i]->latch().unlock();
+    }
+  }
+}
+
 BlockInfo *BufferManager::GetFileBlock(string db_name, string tb_name,
                                        int file_type, int block_num) {
+  return GetFileBlock(GetFileId(db_name, tb_name, file_type), block_num);
+}
+
+BlockInfo *BufferManager::PinFileBlock(int file_id, int block_num) {
+  int shard = ShardOf(file_id, block_num);
+  lock_guard<mutex> lock(shards_[shard]->latch());
+  BlockInfo *block = FetchBlock(shard, file_id, block_num);
+  block->Pin();
+  return block;
+}
 
-  fhandle_->IncreaseAge();
+BlockInfo *BufferManager::PinNewFileBlock(int file_id, int block_num) {
+  int shard = ShardOf(file_id, block_num);
+  lock_guard<mutex> lock(shards_[shard]->latch());
+  FileHandle *fhandle = shards_[shard];
+  BlockInfo *block = fhandle->GetBlockInfo(file_id, block_num);
+  if (block == NULL) {
+    block = GetUsableBlock(shard);
+    block->set_block_num(block_num);
+    block->set_file(ftable_->GetFileInfo(file_id));
+    block->Unmap();
+    if (options_.storage == STORAGE_MMAP) {
+      char *data = ftable_->MapBlock(file_id, block_num);
+      if (data != NULL) {
+        block->Map(data);
+      }
+    }
+    fhandle->AddBlockInfo(block);
+  }
+  memset(block->data(), 0, block->size());
+  block->Pin();
+  return block;
+}
 
-  FileInfo *file = fhandle_->GetFileInfo(db_name, tb_name, file_type);
+void BufferManager::PinBlock(BlockInfo *block) {
+  lock_guard<mutex> lock(shards_[block->shard()]->latch());
+  block->Pin();
+}
 
-  // remember fhandle is the container of all blocks that are currently in use
+void BufferManager::UnpinBlock(BlockInfo *block) {
+  lock_guard<mutex> lock(shards_[block->shard()]->latch());
+  block->Unpin();
+}
 
-  if (file) { // fhandle_ contains blocks whose file_info matches with the file_info you are looking for
-    BlockInfo *block = fhandle_->GetBlockInfo(file, block_num);
-    // if fhandle contains the block of which the file info and block_num matches with what you need
-    if (block) {
-      return block;
-    } 
-    // else, get one block either from bhandle_ (empty block) or from fhandle_ (recycled block)
-    // then set the block to what you need
-    // and add it back to fhandle
-    else {
-      BlockInfo *bp = GetUsableBlock();
-      bp->set_block_num(block_num);
-      bp->set_file(file);
-      bp->ReadInfo(path_);
-      fhandle_->AddBlockInfo(bp);
-      return bp;
+BlockInfo *BufferManager::GetUsableBlock(int shard) {
+  if (bhandle_->bcount(shard) > 0) { // if bhandle_ still has empty blocks for the shard
+    return bhandle_->GetUsableBlock(shard);
+  } else { // no empty blocks left, therefore need to recycle the block chosen by the replacer of the shard
+    BlockInfo *block = shards_[shard]->RecycleBlock(); // a dirty block is written back first
+    if (block == NULL) {
+      throw BufferPoolExhaustedException();
     }
-  } else { // fhandle_ does not contain blocks whose file_info matches with the file_info you are looking for
-    BlockInfo *bp = GetUsableBlock(); // get one block either from bhandle_ (empty block) or from fhandle_ (recycled block)
-    bp->set_block_num(block_num); // set the block to what you need
-    FileInfo *fp = new FileInfo(db_name, file_type, tb_name, 0, 0, NULL, NULL); // add new file_info into fhandle_
-    fhandle_->AddFileInfo(fp);
-    bp->set_file(fp);
-    bp->ReadInfo(path_);
-    fhandle_->AddBlockInfo(bp);
-    return bp;
+    return block;
   }
-  return 0;
 }
 
+void BufferManager::WriteBlock(BlockInfo *block) {
+  int shard = block->shard();
+  bool wake;
+  {
+    lock_guard<mutex> lock(shards_[shard]->latch());
+    wake = shards_[shard]->MarkDirty(block) && OverDirtyRatio(shard);
+  }
+  if (wake && writer_.joinable()) {
+    {
+      lock_guard<mutex> lock(writer_latch_);
+      wake_writer_ = true;
+    }
+    writer_cv_.notify_one();
+  }
+}
 
-BlockInfo *BufferManager::GetUsableBlock() {
-  if (bhandle_->bcount() > 0) { // if bhandle_ still has empty blocks
-    return bhandle_->GetUsableBlock(); // remember that handle_->GetUsableBlock() will write the data from the block to the memory
-  } else { // b_handle has no empty blocks, therefore need to recycle the oldest block from fhandle_
-    return fhandle_->RecycleBlock(); // remember that handle_->GetUsableBlock() will write the data from the block to the memory
+void BufferManager::WriteToDisk() { // write every blocks in every shard to disk
+  for (unsigned int i = 0; i < shards_.size(); ++i) {
+    lock_guard<mutex> lock(shards_[i]->latch());
+    shards_[i]->WriteToDisk();
+  }
+  if (options_.storage == STORAGE_MMAP) {
+    ftable_->Sync();
   }
 }
 
-void BufferManager::WriteBlock(BlockInfo *block) { block->set_dirty(true); }
+bool BufferManager::OverDirtyRatio(int shard) {
+  return shards_[shard]->dirty_count() > options_.dirty_ratio * bhandle_->shard_size(shard);
+}
+
+// Wake up every flush_interval_ms, or earlier when WriteBlock makes too many blocks of a shard dirty,
+// and write back the dirty blocks shard by shard in batches, letting the statements in between the batches
+// Pinned blocks are left for the next round
+void BufferManager::WriterLoop() {
+  while (true) {
+    {
+      unique_lock<mutex> lock(writer_latch_);
+      writer_cv_.wait_for(lock, chrono::milliseconds(options_.flush_interval_ms),
+                          [this] { return stop_writer_ || wake_writer_; });
+      if (stop_writer_) {
+        return;
+      }
+      wake_writer_ = false;
+    }
+
+    for (unsigned int i = 0; i < shards_.size(); ++i) {
+      unique_lock<mutex> lock(shards_[i]->latch());
+      long long page = shards_[i]->WriteDirtyPages(0, WRITER_BATCH_PAGES, true);
+      while (page != -1) {
+        lock.unlock();
+        lock.lock();
+        page = shards_[i]->WriteDirtyPages(page, WRITER_BATCH_PAGES, true);
+      }
+    }
+  }
+}
+
+// Throw away the cached blocks of the file and close it, so nothing is written to a deleted file
+void BufferManager::DropFile(string db_name, string tb_name, int file_type) {
+  int file_id = ftable_->FindFileId(db_name, tb_name, file_type);
+  if (file_id == -1) {
+    return;
+  }
+  for (unsigned int i = 0; i < shards_.size(); ++i) {
+    lock_guard<mutex> lock(shards_[i]->latch());
+    vector<BlockInfo *> blocks = shards_[i]->DropFile(file_id);
+    for (unsigned int j = 0; j < blocks.size(); ++j) {
+      bhandle_->FreeBlock(blocks[j]);
+    }
+  }
+  ftable_->CloseFile(file_id);
+}
+
+double BufferManager::HitRatio(BufferStats &stats) {
+  long hits = BufferStats::Get(stats.hits);
+  long total = hits + BufferStats::Get(stats.misses);
+  if (total == 0) {
+    return 0;
+  }
+  return (double)hits / total;
+}
 
-void BufferManager::WriteToDisk() { fhandle_->WriteToDisk(); } // write every blocks in fhandle_ to disk
\ No newline at end of file
+void BufferManager::PrintStats() {
+  BufferStats &stats = ftable_->stats();
+  cout << "Buffer hits: " << BufferStats::Get(stats.hits)
+       << ", misses: " << BufferStats::Get(stats.misses)
+       << ", hit ratio: " << HitRatio(stats) * 100 << "%" << endl;
+}
+
+static void PrintStatsRow(string name, BufferStats &stats) {
+  long misses = BufferStats::Get(stats.misses);
+  ios state(NULL); // fixed and the precision only for the row, not for what cout prints later
+  state.copyfmt(cout);
+  cout << setw(24) << left << name << setw(12) << BufferStats::Get(stats.hits)
+       << setw(10) << misses << setw(10) << fixed << setprecision(2)
+       << BufferManager::HitRatio(stats) * 100 << setw(11) << BufferStats::Get(stats.evictions)
+       << setw(12) << BufferStats::Get(stats.writebacks) << setw(12)
+       << BufferStats::Get(stats.read_ahead) << setw(12)
+       << (misses == 0 ? 0 : BufferStats::Get(stats.read_ns) / misses / 1000.0)
+       << endl;
+  cout.copyfmt(state);
+}
+
+void BufferManager::ShowStats() {
+  const char *policies[] = {"lru", "clock", "2q"};
+  const char *storages[] = {"buffered", "mmap"};
+  int in_use = 0, dirty = 0;
+  for (unsigned int i = 0; i < shards_.size(); ++i) {
+    lock_guard<mutex> lock(shards_[i]->latch());
+    in_use += shards_[i]->block_count();
+    dirty += shards_[i]->dirty_count();
+  }
+  cout << "BUFFER POOL: " << options_.pool_pages << " pages in "
+       << shards_.size() << " shard(s), " << in_use << " in use, " << dirty
+       << " dirty, replacer " << policies[options_.replacer] << ", storage "
+       << storages[options_.storage] << ", io " << shards_[0]->io()->name() << endl;
+  cout << setw(24) << left << "FILE" << setw(12) << "HITS" << setw(10)
+       << "MISSES" << setw(10) << "HIT %" << setw(11) << "EVICTIONS"
+       << setw(12) << "WRITEBACKS" << setw(12) << "READ-AHEAD" << setw(12)
+       << "AVG READ us" << endl;
+  int file_count = ftable_->file_count();
+  for (int i = 0; i < file_count; ++i) {
+    FileInfo *fp = ftable_->GetFileInfo(i);
+    if (fp->fd() == -1) { // dropped
+      continue;
+    }
+    string name = fp->file_name() + (fp->type() == FORMAT_INDEX ? ".index" : ".records");
+    PrintStatsRow(name, fp->stats());
+  }
+  PrintStatsRow("(total)", ftable_->stats());
+}
+
+// The arena, one BlockInfo per block, and one page table entry per block in use
+long BufferManager::MemoryUsage() {
+  long page_table_entry = sizeof(long long) + 3 * sizeof(void *);
+  long usage = bhandle_->arena_bytes() + (long)bhandle_->bsize() * sizeof(BlockInfo);
+  for (unsigned int i = 0; i < shards_.size(); ++i) {
+    lock_guard<mutex> lock(shards_[i]->latch());
+    usage += (long)shards_[i]->block_count() * page_table_entry;
+  }
+  return usage;
+}
+
+void BufferManager::PrintMemoryUsage() {
+  int in_use = 0;
+  for (unsigned int i = 0; i < shards_.size(); ++i) {
+    lock_guard<mutex> lock(shards_[i]->latch());
+    in_use += shards_[i]->block_count();
+  }
+  cout << "Buffer pool: " << bhandle_->bsize() << " pages of " << page_size_ / 1024
+       << " KB in " << shards_.size()
+       << " shard(s), " << in_use << " in use, " << MemoryUsage() / 1024
+       << " KB" << (bhandle_->huge_pages() ? " (huge pages)" : "") << endl;
+}
+
+// The arena is one mapping, so resizing builds a new one and copies the blocks in use over,
+// shard by shard and oldest first so that the replacers keep their order; dirty blocks stay dirty
+// The number of shards stays the same, every shard keeps its part of the new size
+void BufferManager::Resize(int pool_pages) {
+  vector<unique_lock<mutex> > locks;
+  for (unsigned int i = 0; i < shards_.size(); ++i) {
+    locks.push_back(unique_lock<mutex>(shards_[i]->latch()));
+  }
+  if (pool_pages < min_pool_pages()) {
+    throw InvalidValueException();
+  }
+  for (unsigned int i = 0; i < shards_.size(); ++i) {
+    if (shards_[i]->HasPinnedBlocks()) {
+      throw BufferPoolExhaustedException();
+    }
+  }
+
+  BlockHandle *bhandle =
+      new BlockHandle(path_, pool_pages, page_size_, shards_.size(), options_.huge_pages);
+  for (unsigned int i = 0; i < shards_.size(); ++i) {
+    FileHandle *fhandle = shards_[i];
+    while (fhandle->block_count() > bhandle->shard_size(i)) {
+      bhandle_->FreeBlock(fhandle->RecycleBlock());
+    }
+    vector<BlockInfo *> blocks = fhandle->TakeBlocks();
+    for (unsigned int j = 0; j < blocks.size(); ++j) {
+      BlockInfo *bp = bhandle->GetUsableBlock(i);
+      bp->set_file(blocks[j]->file());
+      bp->set_block_num(blocks[j]->block_num());
+      bp->set_dirty(blocks[j]->dirty());
+      if (blocks[j]->mapped()) {
+        bp->Map(blocks[j]->data());
+      } else {
+        memcpy(bp->data(), blocks[j]->data(), page_size_);
+      }
+      fhandle->AddBlockInfo(bp);
+    }
+  }
+  delete bhandle_;
+  bhandle_ = bhandle;
+  options_.pool_pages = pool_pages;
+}
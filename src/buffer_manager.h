@@ -1,32 +1,130 @@
 #ifndef MINIDB_BUFFER_MANAGER_H_
 #define MINIDB_BUFFER_MANAGER_H_
 
+#include <condition_variable>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "block_handle.h"
 #include "file_handle.h"
+#include "file_table.h"
 #include "block_info.h"
+#include "commons.h"
 
+// A smaller buffer (or shard of it) could not hold the blocks pinned by one B+ tree operation
+#define MIN_POOL_PAGES 16
+// The writer thread gives the latch of a shard back to the statements after writing this many blocks
+#define WRITER_BATCH_PAGES 32
+// Blocks [8k, 8k + 8) of a file go to the same shard, so the writeback of neighbouring blocks can still be coalesced
+#define SHARD_EXTENT_PAGES 8
+// Pages per shard at least when the number of shards is picked automatically
+#define SHARD_AUTO_PAGES 64
+
+// Startup options of the buffer, read from the environment and the command line in main
+struct BufferOptions {
+  int replacer;   // REPLACER_2Q, REPLACER_LRU or REPLACER_CLOCK
+  int pool_pages; // number of blocks in the buffer, changed at runtime by SET buffer_pool_pages
+  int shards;     // number of parts of the buffer with a latch of their own, 0 picks one per core
+  int storage;    // STORAGE_BUFFERED or STORAGE_MMAP
+  int io;         // IO_SYNC or IO_URING, the I/O backend of every shard
+  bool huge_pages; // back the blocks with huge pages if the system has them
+  int flush_interval_ms; // how often the writer thread writes back dirty blocks, 0 disables it
+  double dirty_ratio;    // wake the writer thread early once this part of the buffer is dirty
+  int read_ahead_pages;  // blocks read ahead of a scan, 0 disables read-ahead
+
+  BufferOptions()
+      : replacer(REPLACER_2Q), pool_pages(300), shards(0),
+        storage(STORAGE_BUFFERED), io(IO_SYNC), huge_pages(false),
+        flush_interval_ms(1000), dirty_ratio(0.25), read_ahead_pages(32) {}
+};
+
+// The buffer is split into shards by a hash of (file id, block number / SHARD_EXTENT_PAGES).
+// Every shard is a file_handle with its own latch, page table, replacer and dirty blocks, and its own
+// range of the blocks of block_handle, so fetching blocks of different shards never waits on one another.
+// Every public method takes the latch of the shard it works on, so a block must be pinned while its data is being changed.
+// The writer thread writes back dirty blocks that are not pinned, a few at a time under the latch of one shard
 class BufferManager {
 private:
-  BlockHandle *bhandle_; // container of initial 300 empty blocks
-  FileHandle *fhandle_;  // container of all blocks that are currently in use
+  BlockHandle *bhandle_; // container of initial options.pool_pages empty blocks
+  FileTable *ftable_;    // every file used by the buffer
+  std::vector<FileHandle *> shards_; // containers of all blocks that are currently in use
   std::string path_;
+  BufferOptions options_;
+  int page_size_; // of the database in use, every block of the buffer has this size
+
+  std::mutex writer_latch_; // guards stop_writer_ and wake_writer_
+  std::condition_variable writer_cv_;
+  std::thread writer_;
+  bool stop_writer_;
+  bool wake_writer_; // a shard went over dirty_ratio
 
-  BlockInfo *GetUsableBlock(); // if bhandle_ has empty block, use it; else recycle the oldest block from fhandle_
+  int ShardOf(int file_id, int block_num);
+  BlockInfo *GetUsableBlock(int shard); // if bhandle_ has empty block in the shard, use it; else recycle the block chosen by the replacer of the shard
+  BlockInfo *FetchBlock(int shard, int file_id, int block_num); // GetFileBlock with the latch of the shard held
+  void ReadBatch(int shard, BlockInfo *bp, int low, int high); // reads bp and the blocks read ahead at once
+  static void ReadAheadDone(IORequest &req, void *arg);
+  bool OverDirtyRatio(int shard);
+  void WriterLoop();
 
 public:
-  BufferManager(std::string p)
-      : bhandle_(new BlockHandle(p, 300)), fhandle_(new FileHandle(p)), path_(p) {}
-  ~BufferManager() {
-    delete bhandle_;
-    delete fhandle_;
-  }
+  BufferManager(std::string p, BufferOptions options, int page_size);
+  ~BufferManager();
+
+  static double HitRatio(BufferStats &stats);
+  void PrintStats(); // One line, when leaving the database
+  void ShowStats();  // SHOW BUFFER STATS, for the buffer and for every open file
 
+  int pool_pages() { return options_.pool_pages; }
+  int page_size() { return page_size_; }
+  int shards() { return shards_.size(); }
+  int min_pool_pages() { return MIN_POOL_PAGES * shards_.size(); }
+  long MemoryUsage(); // bytes held by the arena, the BlockInfos and the page tables
+  void PrintMemoryUsage();
+  // Moves the blocks in use to a new arena; shrinking first writes back and recycles blocks chosen by the replacers
+  void Resize(int pool_pages);
+
+  // Resolve a file to its id once, then pass the id down the hot path
+  int GetFileId(std::string db_name, std::string tb_name, int file_type);
+  BlockInfo *GetFileBlock(int file_id, int block_num);
   BlockInfo *GetFileBlock(std::string db_name, std::string tb_name,
                           int file_type, int block_num);
-  void WriteBlock(BlockInfo *block);
-  void WriteToDisk();
+  // A block returned by GetFileBlock may be recycled by the next GetFileBlock,
+  // pin it to keep using it across other buffer calls
+  BlockInfo *PinFileBlock(int file_id, int block_num);
+  // Like PinFileBlock for a block that is written from scratch, e.g. appended to the file, so it is zeroed instead of read
+  BlockInfo *PinNewFileBlock(int file_id, int block_num);
+  void PinBlock(BlockInfo *block);
+  void UnpinBlock(BlockInfo *block);
+  void WriteBlock(BlockInfo *block); // Only marks the block dirty, it is written back later
+  void WriteToDisk(); // Write back every dirty block now
+  void DropFile(std::string db_name, std::string tb_name, int file_type); // Call before deleting the file
+};
+
+// Keeps a block pinned for as long as the guard lives, also when an exception leaves the scope
+class BlockGuard {
+private:
+  BufferManager *hdl_;
+  BlockInfo *block_;
+
+  BlockGuard(const BlockGuard &);
+  BlockGuard &operator=(const BlockGuard &);
+
+public:
+  BlockGuard(BufferManager *hdl, BlockInfo *block) : hdl_(hdl), block_(block) {
+    if (block_ != NULL) {
+      hdl_->PinBlock(block_);
+    }
+  }
+  ~BlockGuard() {
+    if (block_ != NULL) {
+      hdl_->UnpinBlock(block_);
+    }
+  }
+
+  BlockInfo *get() { return block_; }
+  BlockInfo *operator->() { return block_; }
 };
 
-#endif /* defined(MINIDB_HANDLE_H_) */
\ No newline at end of file
+#endif /* defined(MINIDB_HANDLE_H_) */
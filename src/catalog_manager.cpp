@@ -37,8 +37,8 @@ void CatalogManager::WriteArchiveFile() {
   ofs.close();
 }
 
-void CatalogManager::CreateDatabase(std::string dbname) {
-  dbs_.push_back(Database(dbname));
+void CatalogManager::CreateDatabase(std::string dbname, int page_size) {
+  dbs_.push_back(Database(dbname, page_size));
 }
 
 void CatalogManager::DeleteDatabase(std::string dbname) {
@@ -60,7 +60,8 @@ Database *CatalogManager::GetDB(std::string db_name) {
 
 //=======================Database=============================//
 
-Database::Database(std::string dbname) : db_name_(dbname) {}
+Database::Database(std::string dbname, int page_size)
+    : db_name_(dbname), page_size_(page_size) {}
 
 void Database::CreateTable(SQLCreateTable &st) {
   int record_length = 0;
@@ -135,4 +136,33 @@ int Table::GetAttributeIndex(std::string name) {
     }
   }
   return -1;
-}
\ No newline at end of file
+}
+// free_hint_ only moves back when a block before it gets room, so the search is O(1) amortized
+int Table::FindFreeBlock() {
+  while (free_hint_ < free_map_.size() && free_map_[free_hint_] == 0) {
+    free_hint_++;
+  }
+  if (free_hint_ == free_map_.size()) {
+    return -1;
+  }
+  return free_hint_ * 64 + __builtin_ctzll(free_map_[free_hint_]);
+}
+
+void Table::SetBlockFree(int block_num, bool free) {
+  unsigned int word = block_num / 64;
+  unsigned long long bit = 1ULL << (block_num % 64);
+  if (word >= free_map_.size()) {
+    if (!free) {
+      return;
+    }
+    free_map_.resize(word + 1, 0);
+  }
+  if (free) {
+    free_map_[word] |= bit;
+    if (word < free_hint_) {
+      free_hint_ = word;
+    }
+  } else {
+    free_map_[word] &= ~bit;
+  }
+}
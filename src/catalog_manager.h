@@ -8,7 +8,9 @@
 #include <boost/archive/binary_oarchive.hpp>
 #include <boost/serialization/utility.hpp>
 #include <boost/serialization/vector.hpp>
+#include <boost/serialization/version.hpp>
 
+#include "commons.h"
 #include "sql_statement.h"
 
 class Database;
@@ -38,7 +40,7 @@ public:
   Database *GetDB(std::string db_name);
   void ReadArchiveFile();
   void WriteArchiveFile();
-  void CreateDatabase(std::string dbname);
+  void CreateDatabase(std::string dbname, int page_size);
   void DeleteDatabase(std::string dbname);
 };
 
@@ -50,16 +52,21 @@ private:
   void serialize(Archive &ar, const unsigned int version) {
     ar &db_name_;
     ar &tbs_;
+    if (version > 0) { // catalogs written before version 1 only have 4 KB pages
+      ar &page_size_;
+    }
   }
   std::string db_name_;
   std::vector<Table> tbs_;
+  int page_size_; // of every block of the records and index files of the database
 
 public:
-  Database() {}
-  Database(std::string dbname);
+  Database() : page_size_(PAGE_SIZE_DEFAULT) {}
+  Database(std::string dbname, int page_size);
   ~Database() {}
   Table *GetTable(std::string tb_name);
   std::string db_name() { return db_name_; }
+  int page_size() { return page_size_; }
   void CreateTable(SQLCreateTable &st);
   void DropTable(SQLDropTable &st);
   void DropIndex(SQLDropIndex &st);
@@ -67,6 +74,8 @@ public:
   bool CheckIfIndexExists(std::string index_name);
 };
 
+BOOST_CLASS_VERSION(Database, 1)
+
 class Table {
 private:
   friend class boost::serialization::access;
@@ -80,6 +89,12 @@ private:
     ar &block_count_;
     ar &ats_;
     ar &ids_;
+    if (version > 0) {
+      ar &free_map_;
+      ar &free_hint_;
+    } else { // catalogs written before version 1 have no free-space map, the next insert builds it
+      free_map_built_ = false;
+    }
   }
 
   std::string tb_name_;
@@ -89,13 +104,20 @@ private:
   int first_rubbish_num_;
   int block_count_;
 
+  // Free-space map, bit b of free_map_ is set if block b is in the chain of used blocks and has room for one more record
+  // so an insert finds a block for the new record without reading any block
+  std::vector<unsigned long long> free_map_;
+  unsigned int free_hint_; // no word of free_map_ before this one has a bit set
+  bool free_map_built_;
+
   std::vector<Attribute> ats_; // ats_length also can get the number of attributes
   std::vector<Index> ids_;
 
 public:
   Table()
       : tb_name_(""), record_length_(-1), first_block_num_(-1),
-        first_rubbish_num_(-1), block_count_(0) {}
+        first_rubbish_num_(-1), block_count_(0), free_hint_(0),
+        free_map_built_(true) {}
   ~Table() {}
 
   std::string tb_name() { return tb_name_; }
@@ -118,12 +140,19 @@ public:
   void AddAttribute(Attribute &attr) { ats_.push_back(attr); } // Used
   void IncreaseBlockCount() { block_count_++; }
 
+  bool free_map_built() { return free_map_built_; }
+  void set_free_map_built(bool built) { free_map_built_ = built; }
+  int FindFreeBlock(); // a used block with room for one more record, -1 if they are all full
+  void SetBlockFree(int block_num, bool free);
+
   std::vector<Index> &ids() { return ids_; }
   Index *GetIndex(int num) { return &(ids_[num]); }
   unsigned long GetIndexNum() { return ids_.size(); }
   void AddIndex(Index &idx) { ids_.push_back(idx); }
 };
 
+BOOST_CLASS_VERSION(Table, 1)
+
 class Attribute {
 private:
   friend class boost::serialization::access;
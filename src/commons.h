@@ -18,4 +18,25 @@
 #define SIGN_LE 4
 #define SIGN_GE 5
 
+// Buffer Replacement Policy
+#define REPLACER_LRU 0
+#define REPLACER_CLOCK 1
+#define REPLACER_2Q 2
+
+// Buffer Storage, blocks copied into the frames of the buffer or pointing into mmap-ed files
+#define STORAGE_BUFFERED 0
+#define STORAGE_MMAP 1
+
+// Buffer I/O Backend
+#define IO_SYNC 0
+#define IO_URING 1
+
+// Page Size, chosen per database by CREATE DATABASE ... PAGE_SIZE = N, a power of two between these
+#define PAGE_SIZE_DEFAULT 4096
+#define PAGE_SIZE_MIN 4096
+#define PAGE_SIZE_MAX 65536
+
+// Buffer Read-Ahead, fetches of neighbouring blocks in a row before a file is read ahead
+#define READ_AHEAD_TRIGGER 4
+
 #endif
@@ -27,4 +27,16 @@ class IndexMustBeCreatedOnPKException : public std::exception {};
 
 class PrimaryKeyConflictException : public std::exception {};
 
+class BufferPoolExhaustedException : public std::exception {};
+
+class InvalidValueException : public std::exception {};
+
+class FileNotExistException : public std::exception {};
+
+class AttributeNotExistException : public std::exception {};
+
+class IndexPositionOverflowException : public std::exception {};
+
+class ValueCountMismatchException : public std::exception {};
+
 #endif
\ No newline at end of file
@@ -1,142 +1,162 @@
 #include "file_handle.h"
 
-#include <fstream>
+#include <limits.h>
+
+#include <iostream>
 
 #include "commons.h"
 
 using namespace std;
 
 FileHandle::~FileHandle() {
-  WriteToDisk();
-  FileInfo *fp = first_file_;
-  while (fp != NULL) {
-    FileInfo *fpn = fp->next();
-    BlockInfo *bp = fp->first_block();
-    while (bp != NULL) {
-      BlockInfo *bpn = bp->next();
-      delete bp;
-      bp = bpn;
-    }
-    delete fp;
-    fp = fpn;
-  }
-}
-
-// Add fileinfo to the last
-void FileHandle::AddFileInfo(FileInfo *file) {
-  FileInfo *p = first_file_;
-  if (p == NULL) {
-    p = file;
-  } else {
-    while (p->next() != NULL) {
-      p = p->next();
-    }
-    p->set_next(file);
-  }
+  WriteToDisk(); // the blocks themselves belong to block_handle
+  delete replacer_;
+  delete io_;
 }
 
-FileInfo *FileHandle::GetFileInfo(std::string db_name, std::string tb_name,
-                                  int file_type) {
-  FileInfo *p = first_file_;
-  while (p != NULL) {
-    if (p->db_name() == db_name && p->type() == file_type &&
-        p->file_name() == tb_name) {
-      return p;
+// Forget the blocks of the file without writing them back, returns them
+// Used when the file is deleted
+std::vector<BlockInfo *> FileHandle::DropFile(int file_id) {
+  vector<BlockInfo *> blocks;
+  for (unordered_map<long long, BlockInfo *>::iterator iter = page_table_.begin();
+       iter != page_table_.end();) {
+    BlockInfo *bp = iter->second;
+    if (bp->file()->file_id() == file_id) {
+      replacer_->Remove(bp);
+      if (bp->dirty()) {
+        bp->set_dirty(false);
+        dirty_pages_.erase(iter->first);
+      }
+      blocks.push_back(bp);
+      iter = page_table_.erase(iter);
+    } else {
+      ++iter;
     }
-    p = p->next();
   }
-  return NULL;
+  return blocks;
 }
 
-BlockInfo *FileHandle::GetBlockInfo(FileInfo *file, int block_pos) {
-  BlockInfo *p = file->first_block();
-  while (p != NULL) {
-    if (p->block_num() == block_pos) {
-      return p;
-    }
-    p = p->next();
+BlockInfo *FileHandle::GetBlockInfo(int file_id, int block_num) {
+  unordered_map<long long, BlockInfo *>::iterator iter =
+      page_table_.find(PageKey(file_id, block_num));
+  if (iter == page_table_.end()) {
+    return NULL;
   }
-  return NULL;
+  replacer_->Access(iter->second);
+  return iter->second;
 }
 
-// Add block to the last
+// Add block to the page table and the replacer
 void FileHandle::AddBlockInfo(BlockInfo *block) {
-  BlockInfo *p = block->file()->first_block();
-  if (p == NULL) {
-    block->file()->set_first_block(block);
-  } else {
-    while (p->next() != NULL) {
-      p = p->next();
-    }
-    p->set_next(block);
+  long long page = PageKey(block->file()->file_id(), block->block_num());
+  page_table_[page] = block;
+  replacer_->Insert(block);
+  if (block->dirty()) {
+    dirty_pages_.insert(page);
   }
-  block->file()->IncreaseRecordAmount();
-  block->file()->IncreaseRecordLength();
 }
 
-// Increase age for all blocks inside all files
-void FileHandle::IncreaseAge() {
-  FileInfo *fp = first_file_;
-  while (fp != NULL) {
-    BlockInfo *bp = fp->first_block();
-    while (bp != NULL) {
-      bp->IncreaseAge();
-      bp = bp->next();
-    }
-    fp = fp->next();
+bool FileHandle::MarkDirty(BlockInfo *block) {
+  if (block->dirty()) {
+    return false;
   }
+  block->set_dirty(true);
+  dirty_pages_.insert(PageKey(block->file()->file_id(), block->block_num()));
+  return true;
 }
 
-// Pop and get the oldest block
+// Pop and get the block chosen by the replacer
 BlockInfo *FileHandle::RecycleBlock() {
+  BlockInfo *victim = replacer_->Victim();
+  if (victim == NULL) { // every block is pinned
+    return NULL;
+  }
 
-  FileInfo *fp = first_file_;
+  long long page = PageKey(victim->file()->file_id(), victim->block_num());
+  if (victim->dirty()) {
+    victim->WriteInfo();
+    victim->set_dirty(false);
+    dirty_pages_.erase(page);
+    BufferStats::Add(files_->stats().writebacks, 1);
+    BufferStats::Add(victim->file()->stats().writebacks, 1);
+  }
+  BufferStats::Add(files_->stats().evictions, 1);
+  BufferStats::Add(victim->file()->stats().evictions, 1);
 
-  BlockInfo *oldestbefore = NULL;
-  BlockInfo *oldest = fp->first_block();
+  page_table_.erase(page);
 
-  while (fp != NULL) {
-    BlockInfo *bpbefore = NULL;
-    BlockInfo *bp = fp->first_block();
-    while (bp != NULL) {
+  victim->set_next(NULL);
 
-      if (bp->age() > oldest->age()) {
-        oldestbefore = bpbefore;
-        oldest = bp;
-      }
-      bpbefore = bp;
-      bp = bp->next();
+  return victim;
+}
+
+bool FileHandle::HasPinnedBlocks() {
+  for (unordered_map<long long, BlockInfo *>::iterator iter = page_table_.begin();
+       iter != page_table_.end(); ++iter) {
+    if (iter->second->pinned()) {
+      return true;
     }
-    fp = fp->next();
   }
+  return false;
+}
 
-  if (oldest->dirty()) {
-    oldest->WriteInfo(path_);
+// Empty the page table in the order the replacer would recycle the blocks, without writing them back
+// Adding them again in the returned order gives the replacer the same order as before
+vector<BlockInfo *> FileHandle::TakeBlocks() {
+  vector<BlockInfo *> blocks;
+  BlockInfo *bp;
+  while ((bp = replacer_->Victim()) != NULL) {
+    blocks.push_back(bp);
   }
+  // start over, so that the history kept by the replacer (2Q) does not take the blocks for read again
+  delete replacer_;
+  replacer_ = Replacer::Create(policy_);
+  page_table_.clear();
+  dirty_pages_.clear();
+  return blocks;
+}
 
-  if (oldestbefore == NULL) {
-    oldest->file()->set_first_block(oldest->next());
-  } else {
-    oldestbefore->set_next(oldest->next());
+void FileHandle::WriteDone(IORequest &req, void *arg) {
+  FileHandle *fhandle = (FileHandle *)arg;
+  for (unsigned int i = 0; i < req.blocks.size(); ++i) {
+    req.blocks[i]->set_dirty(false);
   }
-
-  oldest->ResetAge();
-  oldest->set_next(NULL);
-
-  return oldest;
+  BufferStats::Add(fhandle->files_->stats().writebacks, req.blocks.size());
+  BufferStats::Add(req.blocks[0]->file()->stats().writebacks, req.blocks.size());
 }
 
-void FileHandle::WriteToDisk() {
-  FileInfo* fp = first_file_;
-  while (fp != NULL) {
-    BlockInfo* bp = fp->first_block();
-    while (bp != NULL) {
-      if (bp->dirty()) {
-        bp->WriteInfo(path_);
-        bp->set_dirty(false);
-      }
-      bp = bp->next();
+// The dirty blocks are visited in page key order, that is by file and then by block number,
+// so blocks next to each other in a file end up in one run and go out in one pwritev.
+// All runs are handed to the I/O backend as one batch
+long long FileHandle::WriteDirtyPages(long long from, int max_pages,
+                                      bool skip_pinned) {
+  vector<IORequest> batch;
+  BlockInfo *last = NULL; // last block of the current run, NULL if there is none
+  int count = 0;
+  set<long long>::iterator iter = dirty_pages_.lower_bound(from);
+  while (iter != dirty_pages_.end() && count < max_pages) {
+    BlockInfo *bp = page_table_[*iter];
+    if (skip_pinned && bp->pinned()) { // left for the next time
+      last = NULL;
+      ++iter;
+      continue;
     }
-    fp = fp->next();
+    if (last == NULL || bp->file() != last->file() ||
+        bp->block_num() != last->block_num() + 1 ||
+        batch.back().blocks.size() == IOV_MAX) {
+      batch.push_back(IORequest(IO_OP_WRITE, WriteDone, this));
+    }
+    batch.back().blocks.push_back(bp);
+    last = bp;
+    count++;
+    iter = dirty_pages_.erase(iter);
+  }
+  if (!batch.empty()) {
+    io_->Submit(batch);
   }
-}
\ No newline at end of file
+  return iter == dirty_pages_.end() ? -1 : *iter;
+}
+
+void FileHandle::WriteToDisk() {
+  WriteDirtyPages(0, dirty_pages_.size(), false);
+}
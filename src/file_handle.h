@@ -1,30 +1,65 @@
 #ifndef MINIDB_FILE_HANDLE_H_
 #define MINIDB_FILE_HANDLE_H_
 
+#include <mutex>
+#include <set>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "block_info.h"
 #include "file_info.h"
+#include "file_table.h"
+#include "io_backend.h"
+#include "replacer.h"
 
 // file_handle is the handle that really uses a block.
 // Such blocks are initially taken from block_handle as empty blocks
-// once all empty blocks are used up in block_handle, if file_handle needs to use more blocks it will recycle the oldest block
+// once all empty blocks are used up in block_handle, if file_handle needs to use more blocks it will recycle the block chosen by its replacer
 // once a block has finished its usage, file_handle will then put back the block (as empty block) into block_handle
+//
+// The blocks in use are kept in a hashed page table keyed on (file id, block number),
+// so finding a cached block is O(1) and compares no strings.
+// Every shard of the buffer is one file_handle with its own latch, page table, replacer and dirty blocks;
+// all its methods are called with latch() held
 class FileHandle {
 private:
-  FileInfo *first_file_;
-  std::string path_;
+  FileTable *files_;
+  std::mutex latch_;
+  std::unordered_map<long long, BlockInfo *> page_table_; // PageKey(file id, block number) -> block
+  Replacer *replacer_; // tracks every block in page_table_
+  int policy_;
+  std::set<long long> dirty_pages_; // PageKey of every dirty block, in file and block order
+  IOBackend *io_;
+
+  static void WriteDone(IORequest &req, void *arg);
 
 public:
-  FileHandle(std::string p) : first_file_(new FileInfo()), path_(p) {}
+  FileHandle(FileTable *files, int policy, int io)
+      : files_(files), replacer_(Replacer::Create(policy)), policy_(policy),
+        io_(IOBackend::Create(io)) {}
   ~FileHandle();
-  FileInfo* GetFileInfo(std::string db_name, std::string tb_name,
-                        int file_type);
-  BlockInfo* GetBlockInfo(FileInfo *file, int block_pos);
-  void AddBlockInfo(BlockInfo *block); // Add block to the last
-  void IncreaseAge(); // Increase age for all blocks inside all files
-  BlockInfo *RecycleBlock(); // Pop and get the oldest block
-  void AddFileInfo(FileInfo *file); // Add fileinfo to the last
+
+  static long long PageKey(int file_id, int block_num) {
+    return ((long long)file_id << 32) | (unsigned int)block_num;
+  }
+
+  std::mutex &latch() { return latch_; }
+  int policy() { return policy_; }
+  IOBackend *io() { return io_; }
+  std::vector<BlockInfo *> DropFile(int file_id); // Forget the blocks of the file without writing them back, returns them
+  int block_count() { return page_table_.size(); } // blocks currently in use
+  int dirty_count() { return dirty_pages_.size(); }
+  BlockInfo *GetBlockInfo(int file_id, int block_num); // A hit counts as an access for the replacer
+  bool HasBlock(int file_id, int block_num) { return page_table_.count(PageKey(file_id, block_num)) > 0; }
+  void AddBlockInfo(BlockInfo *block); // Add block to the page table and the replacer
+  BlockInfo *RecycleBlock(); // Pop and get the block chosen by the replacer, NULL if all blocks are pinned
+  bool HasPinnedBlocks();
+  std::vector<BlockInfo *> TakeBlocks(); // Empty the page table, oldest block first; no block may be pinned
+  bool MarkDirty(BlockInfo *block); // false if the block was dirty already
+  // Write back up to max_pages dirty blocks in page order from the page key from,
+  // returns the page key to go on from, -1 when done
+  long long WriteDirtyPages(long long from, int max_pages, bool skip_pinned);
   void WriteToDisk();
 };
 
@@ -1,29 +1,68 @@
 #ifndef MINIDB_FILE_INFO_H_
 #define MINIDB_FILE_INFO_H_
 
+#include <atomic>
+#include <mutex>
 #include <string>
 
 #include "commons.h"
 
-class BlockInfo;
+// Where the last blocks fetched from a file were, to notice a scan along neighbouring blocks
+typedef struct {
+  int last_block; // block number of the last fetch
+  int step;       // 1 or -1 while the fetches move by one block in the same direction, else 0
+  int length;     // number of such fetches in a row
+  int next;       // first block in the scan direction that has not been read ahead yet
+} ScanState;
+
+// Counters of the buffer, for one file and for the whole buffer
+// They are relaxed atomics, so SHOW BUFFER STATS can read them while the writer thread counts
+struct BufferStats {
+  std::atomic<long> hits;       // block found in the buffer
+  std::atomic<long> misses;     // block read from disk
+  std::atomic<long> evictions;  // block recycled for another one
+  std::atomic<long> writebacks; // dirty block written to disk
+  std::atomic<long> read_ahead; // posix_fadvise calls of the read-ahead
+  std::atomic<long> read_ns;    // time spent reading blocks
+
+  BufferStats()
+      : hits(0), misses(0), evictions(0), writebacks(0), read_ahead(0),
+        read_ns(0) {}
+
+  static void Add(std::atomic<long> &counter, long n) {
+    counter.fetch_add(n, std::memory_order_relaxed);
+  }
+  static long Get(std::atomic<long> &counter) {
+    return counter.load(std::memory_order_relaxed);
+  }
+};
 
 class FileInfo {
 private:
   std::string db_name_;
   int type_;               // 0: data file, 1: index file
   std::string file_name_;  // the name of the file
-  int record_amount_;      // the number of record in the file
-  int record_length_;      // the length of the record in the file
-  BlockInfo *first_block_; // point to the first block within the file
-  FileInfo *next_;         // the pointer points to the next file
+  int file_id_;            // the id assigned by file_handle, used as the page table key
+  int fd_;                 // kept open by file_handle for pread/pwrite of the blocks, -1 if closed
+  char *map_;              // address range reserved for the mapping of the file in mmap storage, NULL if not mapped
+  long map_bytes_;         // bytes of the file mapped at map_, the mapping may run past the end of the file
+  long file_bytes_;        // size of the file as last seen or set by the mapping, it may have grown since
+  ScanState scan_;
+  std::mutex scan_latch_; // fetches of different shards may update scan_ at the same time
+  BufferStats stats_;
 public:
   FileInfo()
-      : db_name_(""), type_(FORMAT_RECORD), file_name_(""), record_amount_(0),
-        record_length_(0), first_block_(0), next_(0) {}
-  FileInfo(std::string db, int tp, std::string file, int reca, int recl,
-           FileInfo *nex, BlockInfo *firb)
-      : db_name_(db), type_(tp), file_name_(file), record_amount_(reca),
-        record_length_(recl), first_block_(firb), next_(nex) {}
+      : db_name_(""), type_(FORMAT_RECORD), file_name_(""), file_id_(-1),
+        fd_(-1), map_(NULL), map_bytes_(0), file_bytes_(0) {
+    scan_.last_block = -1;
+    scan_.step = scan_.length = scan_.next = 0;
+  }
+  FileInfo(std::string db, int tp, std::string file, int id, int fd)
+      : db_name_(db), type_(tp), file_name_(file), file_id_(id), fd_(fd),
+        map_(NULL), map_bytes_(0), file_bytes_(0) {
+    scan_.last_block = -1;
+    scan_.step = scan_.length = scan_.next = 0;
+  }
   ~FileInfo() {}
 
   std::string db_name() { return db_name_; }
@@ -32,14 +71,24 @@ public:
 
   std::string file_name() { return file_name_; }
 
-  BlockInfo *first_block() { return first_block_; }
-  void set_first_block(BlockInfo *bp) { first_block_ = bp; }
+  int file_id() { return file_id_; }
+
+  int fd() { return fd_; }
+  void set_fd(int fd) { fd_ = fd; }
+
+  char *map() { return map_; }
+  long map_bytes() { return map_bytes_; }
+  void set_map(char *map, long bytes) {
+    map_ = map;
+    map_bytes_ = bytes;
+  }
+  long file_bytes() { return file_bytes_; }
+  void set_file_bytes(long bytes) { file_bytes_ = bytes; }
 
-  FileInfo *next() { return next_; }
-  void set_next(FileInfo *fp) { next_ = fp; }
+  ScanState &scan() { return scan_; }
+  std::mutex &scan_latch() { return scan_latch_; }
 
-  void IncreaseRecordAmount() { record_amount_++; }
-  void IncreaseRecordLength() { record_length_ += 4096; }
+  BufferStats &stats() { return stats_; }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,215 @@
+#include "file_table.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <iostream>
+
+#include "commons.h"
+
+using namespace std;
+
+FileTable::~FileTable() {
+  for (unsigned int i = 0; i < files_.size(); ++i) {
+    Unmap(files_[i]);
+    if (files_[i]->fd() != -1) {
+      close(files_[i]->fd());
+    }
+    delete files_[i];
+  }
+}
+
+// Assign a file id and open the file on first use
+// The strings are only compared here, the hot path works with the returned id
+int FileTable::GetFileId(std::string db_name, std::string tb_name,
+                         int file_type) {
+  lock_guard<mutex> lock(latch_);
+  string key = FileKey(db_name, tb_name, file_type);
+  unordered_map<string, int>::iterator iter = file_ids_.find(key);
+  if (iter != file_ids_.end()) {
+    return iter->second;
+  }
+
+  string file_name = path_ + db_name + "/" + tb_name;
+  if (file_type == FORMAT_INDEX) {
+    file_name += ".index";
+  } else {
+    file_name += ".records";
+  }
+  int fd = open(file_name.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd == -1) {
+    cerr << "Failed to open " << file_name << endl;
+  }
+
+  int file_id = files_.size();
+  files_.push_back(new FileInfo(db_name, file_type, tb_name, file_id, fd));
+  file_ids_[key] = file_id;
+  return file_id;
+}
+
+int FileTable::FindFileId(std::string db_name, std::string tb_name,
+                          int file_type) {
+  lock_guard<mutex> lock(latch_);
+  unordered_map<string, int>::iterator iter =
+      file_ids_.find(FileKey(db_name, tb_name, file_type));
+  if (iter == file_ids_.end()) {
+    return -1;
+  }
+  return iter->second;
+}
+
+FileInfo *FileTable::GetFileInfo(int file_id) {
+  lock_guard<mutex> lock(latch_);
+  return files_[file_id];
+}
+
+int FileTable::file_count() {
+  lock_guard<mutex> lock(latch_);
+  return files_.size();
+}
+
+// The blocks of the file must have been dropped from every shard before
+void FileTable::CloseFile(int file_id) {
+  lock_guard<mutex> lock(latch_);
+  FileInfo *fp = files_[file_id];
+  Unmap(fp);
+  if (fp->fd() != -1) {
+    close(fp->fd());
+    fp->set_fd(-1);
+  }
+  file_ids_.erase(FileKey(fp->db_name(), fp->file_name(), fp->type()));
+}
+
+// After READ_AHEAD_TRIGGER fetches of neighbouring blocks in one direction the file is taken to be scanned,
+// and on a miss the kernel is asked with posix_fadvise to read the next pages blocks in that direction in the background
+// Blocks added to a table go to the front of its block chain, so a scan often moves towards block 0
+// Returns whether the file is read ahead, [*low, *high] are then the blocks read ahead that the file has
+bool FileTable::ReadAhead(int file_id, int block_num, bool miss, int pages,
+                          int *low, int *high) {
+  FileInfo *fp = GetFileInfo(file_id);
+  lock_guard<mutex> lock(fp->scan_latch());
+  ScanState &scan = fp->scan();
+  int step = block_num - scan.last_block;
+  if (step == 0) { // the same block again, e.g. the next record in it
+    return false;
+  }
+  scan.last_block = block_num;
+
+  if (step != 1 && step != -1) {
+    scan.step = 0;
+    scan.length = 0;
+    return false;
+  }
+  if (step != scan.step) {
+    scan.step = step;
+    scan.length = 0;
+    scan.next = block_num + step;
+  }
+  scan.length++;
+
+  if (!miss || pages <= 0 || scan.length < READ_AHEAD_TRIGGER) {
+    return false;
+  }
+  int ahead = (scan.next - block_num) * step; // blocks already read ahead of this one
+  if (ahead > pages / 2) {
+    return false;
+  }
+  int first = ahead > 0 ? scan.next : block_num + step;
+  int last = first + step * (pages - 1);
+  scan.next = last + step;
+
+  *low = first < last ? first : last;
+  *high = first < last ? last : first;
+  if (*low < 0) {
+    *low = 0;
+  }
+  if (*high < *low) {
+    return false;
+  }
+  posix_fadvise(fp->fd(), (off_t)*low * page_size_, (off_t)(*high - *low + 1) * page_size_,
+                POSIX_FADV_WILLNEED);
+  BufferStats::Add(stats_.read_ahead, 1);
+  BufferStats::Add(fp->stats().read_ahead, 1);
+
+  struct stat st;
+  if (fstat(fp->fd(), &st) == 0 && *high >= st.st_size / page_size_) {
+    *high = st.st_size / page_size_ - 1;
+  }
+  return *high >= *low;
+}
+
+// The whole MMAP_RESERVE_BYTES are reserved with one PROT_NONE mapping on first use, and the file is mapped
+// over the start of it with MAP_FIXED, MMAP_GROW_BYTES or more at a time. The mapping may run past the end of
+// the file, but the file is only extended with ftruncate up to the end of the block asked for, so it keeps the
+// size the blocks written give it and the new blocks read as zeros like a pread past the end of the file does
+char *FileTable::MapBlock(int file_id, int block_num) {
+  lock_guard<mutex> lock(latch_);
+  FileInfo *fp = files_[file_id];
+  long end = (long)(block_num + 1) * page_size_;
+  if (fp->fd() == -1 || end > MMAP_RESERVE_BYTES) {
+    return NULL;
+  }
+
+  if (fp->map() == NULL) {
+    void *p = mmap(NULL, MMAP_RESERVE_BYTES, PROT_NONE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p == MAP_FAILED) {
+      return NULL;
+    }
+    fp->set_map((char *)p, 0);
+  }
+
+  if (end > fp->file_bytes()) { // a block past the end the file had when last seen
+    struct stat st;
+    if (fstat(fp->fd(), &st) == -1) {
+      return NULL;
+    }
+    if (st.st_size < end && ftruncate(fp->fd(), end) == -1) {
+      cerr << "Failed to grow " << fp->file_name() << endl;
+      return NULL;
+    }
+    fp->set_file_bytes(st.st_size < end ? end : st.st_size);
+  }
+
+  if (end > fp->map_bytes()) {
+    long bytes = fp->map_bytes() + MMAP_GROW_BYTES;
+    if (bytes < end) {
+      bytes = end;
+    }
+    if (bytes < fp->file_bytes()) { // map what the file already has
+      bytes = (fp->file_bytes() + page_size_ - 1) / page_size_ * page_size_;
+    }
+    if (bytes > MMAP_RESERVE_BYTES) {
+      bytes = MMAP_RESERVE_BYTES;
+    }
+    void *p = mmap(fp->map() + fp->map_bytes(), bytes - fp->map_bytes(),
+                   PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fp->fd(),
+                   fp->map_bytes());
+    if (p == MAP_FAILED) {
+      cerr << "Failed to map " << fp->file_name() << endl;
+      return NULL;
+    }
+    fp->set_map(fp->map(), bytes);
+  }
+  return fp->map() + (long)block_num * page_size_;
+}
+
+void FileTable::Sync() {
+  lock_guard<mutex> lock(latch_);
+  for (unsigned int i = 0; i < files_.size(); ++i) {
+    FileInfo *fp = files_[i];
+    long bytes = fp->map_bytes() < fp->file_bytes() ? fp->map_bytes() : fp->file_bytes(); // the blocks handed out
+    if (bytes > 0 && msync(fp->map(), bytes, MS_SYNC) == -1) {
+      cerr << "Failed to sync " << fp->file_name() << endl;
+    }
+  }
+}
+
+void FileTable::Unmap(FileInfo *fp) {
+  if (fp->map() != NULL) {
+    munmap(fp->map(), MMAP_RESERVE_BYTES);
+    fp->set_map(NULL, 0);
+  }
+}
@@ -0,0 +1,54 @@
+#ifndef MINIDB_FILE_TABLE_H_
+#define MINIDB_FILE_TABLE_H_
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "file_info.h"
+
+// Address space reserved for the mapping of one file, so the mapping grows in place and blocks never move
+#define MMAP_RESERVE_BYTES (1L << 34)
+// The mapping of a file is grown by at least this many bytes at a time, the file itself only to its last block
+#define MMAP_GROW_BYTES (1L << 20)
+
+// file_table knows every file the buffer has used, it is shared by all shards of the buffer.
+// Every file gets an integer id the first time it is seen, and blocks are keyed on (file id, block number)
+// from then on, so the hot path compares no strings.
+// The file is opened once at that point as well, blocks are then read and written with pread/pwrite on its descriptor.
+// In mmap storage the blocks point into a shared mapping of the file instead, see MapBlock
+class FileTable {
+private:
+  std::vector<FileInfo *> files_;                 // indexed by file id
+  std::unordered_map<std::string, int> file_ids_; // "type:db/file" -> file id
+  BufferStats stats_; // of all files, also the ones dropped since
+  std::string path_;
+  int page_size_;
+  std::mutex latch_;  // taken after the latch of a shard, never before
+
+  void Unmap(FileInfo *fp);
+
+public:
+  FileTable(std::string p, int page_size) : path_(p), page_size_(page_size) {}
+  ~FileTable(); // Close the files
+
+  static std::string FileKey(std::string db_name, std::string tb_name, int file_type) {
+    return std::to_string(file_type) + ":" + db_name + "/" + tb_name;
+  }
+
+  int GetFileId(std::string db_name, std::string tb_name, int file_type); // Assign a file id and open the file on first use
+  int FindFileId(std::string db_name, std::string tb_name, int file_type); // -1 if the file has never been used
+  FileInfo *GetFileInfo(int file_id);
+  int file_count();
+  BufferStats &stats() { return stats_; }
+  void CloseFile(int file_id); // The file is deleted, a file created again under the same name gets a new id
+  // Called for every block fetched from the file
+  bool ReadAhead(int file_id, int block_num, bool miss, int pages, int *low, int *high);
+  // Address of the block in the mapping of the file, growing the file and the mapping if needed
+  // NULL if the block lies past MMAP_RESERVE_BYTES or the file cannot be mapped, then the block is read with pread
+  char *MapBlock(int file_id, int block_num);
+  void Sync(); // msync every mapped file, at the flush points of the buffer
+};
+
+#endif /* defined(MINIDB_FILE_TABLE_H_) */
@@ -0,0 +1,185 @@
+#include "filter_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FILTER_X86
+#endif
+
+#include "commons.h"
+
+// Every sign is one of the comparisons ==, < and >, negated for <>, <= and >=
+#define OP_EQ 0
+#define OP_LT 1
+#define OP_GT 2
+
+typedef void (*IntKernel)(const int *col, int n, int value, unsigned long long *sel);
+typedef void (*FloatKernel)(const float *col, int n, float value, unsigned long long *sel);
+
+template <class T, int OP, bool NEG>
+static void ScalarKernel(const T *col, int n, T value, unsigned long long *sel) {
+  for (int w = 0; w * 64 < n; ++w) {
+    int count = n - w * 64 < 64 ? n - w * 64 : 64;
+    const T *values = col + w * 64;
+    unsigned long long mask = 0;
+    for (int i = 0; i < count; ++i) {
+      bool c = OP == OP_EQ ? values[i] == value
+                           : (OP == OP_LT ? values[i] < value : values[i] > value);
+      mask |= (unsigned long long)(c != NEG) << i;
+    }
+    sel[w] &= mask;
+  }
+}
+
+#ifdef FILTER_X86
+
+// The full words of sel with 16 comparisons of 4 values, the rest with ScalarKernel
+template <int OP, bool NEG>
+__attribute__((target("sse2"))) static void Sse2Ints(const int *col, int n, int value,
+                                                     unsigned long long *sel) {
+  __m128i v = _mm_set1_epi32(value);
+  int w = 0;
+  for (; (w + 1) * 64 <= n; ++w) {
+    unsigned long long mask = 0;
+    for (int k = 0; k < 16; ++k) {
+      __m128i a = _mm_loadu_si128((const __m128i *)(col + w * 64 + k * 4));
+      __m128i c = OP == OP_EQ ? _mm_cmpeq_epi32(a, v)
+                              : (OP == OP_LT ? _mm_cmplt_epi32(a, v) : _mm_cmpgt_epi32(a, v));
+      mask |= (unsigned long long)_mm_movemask_ps(_mm_castsi128_ps(c)) << (k * 4);
+    }
+    sel[w] &= NEG ? ~mask : mask;
+  }
+  ScalarKernel<int, OP, NEG>(col + w * 64, n - w * 64, value, sel + w);
+}
+
+template <int OP, bool NEG>
+__attribute__((target("sse2"))) static void Sse2Floats(const float *col, int n, float value,
+                                                       unsigned long long *sel) {
+  __m128 v = _mm_set1_ps(value);
+  int w = 0;
+  for (; (w + 1) * 64 <= n; ++w) {
+    unsigned long long mask = 0;
+    for (int k = 0; k < 16; ++k) {
+      __m128 a = _mm_loadu_ps(col + w * 64 + k * 4);
+      __m128 c = OP == OP_EQ ? _mm_cmpeq_ps(a, v)
+                             : (OP == OP_LT ? _mm_cmplt_ps(a, v) : _mm_cmpgt_ps(a, v));
+      mask |= (unsigned long long)_mm_movemask_ps(c) << (k * 4);
+    }
+    sel[w] &= NEG ? ~mask : mask;
+  }
+  ScalarKernel<float, OP, NEG>(col + w * 64, n - w * 64, value, sel + w);
+}
+
+// The full words of sel with 8 comparisons of 8 values, the rest with ScalarKernel
+template <int OP, bool NEG>
+__attribute__((target("avx2"))) static void Avx2Ints(const int *col, int n, int value,
+                                                     unsigned long long *sel) {
+  __m256i v = _mm256_set1_epi32(value);
+  int w = 0;
+  for (; (w + 1) * 64 <= n; ++w) {
+    unsigned long long mask = 0;
+    for (int k = 0; k < 8; ++k) {
+      __m256i a = _mm256_loadu_si256((const __m256i *)(col + w * 64 + k * 8));
+      __m256i c = OP == OP_EQ ? _mm256_cmpeq_epi32(a, v)
+                              : (OP == OP_LT ? _mm256_cmpgt_epi32(v, a) : _mm256_cmpgt_epi32(a, v));
+      mask |= (unsigned long long)_mm256_movemask_ps(_mm256_castsi256_ps(c)) << (k * 8);
+    }
+    sel[w] &= NEG ? ~mask : mask;
+  }
+  ScalarKernel<int, OP, NEG>(col + w * 64, n - w * 64, value, sel + w);
+}
+
+template <int OP, bool NEG>
+__attribute__((target("avx2"))) static void Avx2Floats(const float *col, int n, float value,
+                                                       unsigned long long *sel) {
+  __m256 v = _mm256_set1_ps(value);
+  int w = 0;
+  for (; (w + 1) * 64 <= n; ++w) {
+    unsigned long long mask = 0;
+    for (int k = 0; k < 8; ++k) {
+      __m256 a = _mm256_loadu_ps(col + w * 64 + k * 8);
+      __m256 c = OP == OP_EQ ? _mm256_cmp_ps(a, v, _CMP_EQ_OQ)
+                             : (OP == OP_LT ? _mm256_cmp_ps(a, v, _CMP_LT_OQ)
+                                            : _mm256_cmp_ps(a, v, _CMP_GT_OQ));
+      mask |= (unsigned long long)_mm256_movemask_ps(c) << (k * 8);
+    }
+    sel[w] &= NEG ? ~mask : mask;
+  }
+  ScalarKernel<float, OP, NEG>(col + w * 64, n - w * 64, value, sel + w);
+}
+
+#endif
+
+// SIGN_EQ, SIGN_NE, SIGN_LT, SIGN_GT, SIGN_LE, SIGN_GE
+#define SCALAR_KERNELS(T)                                                      \
+  {ScalarKernel<T, OP_EQ, false>, ScalarKernel<T, OP_EQ, true>,                \
+   ScalarKernel<T, OP_LT, false>, ScalarKernel<T, OP_GT, false>,               \
+   ScalarKernel<T, OP_GT, true>, ScalarKernel<T, OP_LT, true>}
+#define KERNELS(K)                                                             \
+  {K<OP_EQ, false>, K<OP_EQ, true>, K<OP_LT, false>,                           \
+   K<OP_GT, false>, K<OP_GT, true>, K<OP_LT, true>}
+
+#ifdef FILTER_X86
+static IntKernel int_kernels[3][6] = {SCALAR_KERNELS(int), KERNELS(Sse2Ints),
+                                      KERNELS(Avx2Ints)};
+static FloatKernel float_kernels[3][6] = {SCALAR_KERNELS(float), KERNELS(Sse2Floats),
+                                          KERNELS(Avx2Floats)};
+#else
+static IntKernel int_kernels[3][6] = {SCALAR_KERNELS(int), SCALAR_KERNELS(int),
+                                      SCALAR_KERNELS(int)};
+static FloatKernel float_kernels[3][6] = {SCALAR_KERNELS(float), SCALAR_KERNELS(float),
+                                          SCALAR_KERNELS(float)};
+#endif
+
+static bool Supports(int kernel) {
+#ifdef FILTER_X86
+  switch (kernel) {
+  case FILTER_AVX2:
+    return __builtin_cpu_supports("avx2");
+  case FILTER_SSE2:
+    return __builtin_cpu_supports("sse2");
+  }
+#endif
+  return kernel == FILTER_SCALAR;
+}
+
+static int DetectKernel() {
+  if (Supports(FILTER_AVX2)) {
+    return FILTER_AVX2;
+  }
+  if (Supports(FILTER_SSE2)) {
+    return FILTER_SSE2;
+  }
+  return FILTER_SCALAR;
+}
+
+static int current_kernel = DetectKernel();
+
+int filter_kernel() { return current_kernel; }
+
+const char *FilterKernelName(int kernel) {
+  switch (kernel) {
+  case FILTER_AVX2:
+    return "avx2";
+  case FILTER_SSE2:
+    return "sse2";
+  default:
+    return "scalar";
+  }
+}
+
+bool SetFilterKernel(int kernel) {
+  if (kernel < FILTER_SCALAR || kernel > FILTER_AVX2 || !Supports(kernel)) {
+    return false;
+  }
+  current_kernel = kernel;
+  return true;
+}
+
+void FilterInts(const int *col, int n, int sign_type, int value, unsigned long long *sel) {
+  int_kernels[current_kernel][sign_type](col, n, value, sel);
+}
+
+void FilterFloats(const float *col, int n, int sign_type, float value,
+                  unsigned long long *sel) {
+  float_kernels[current_kernel][sign_type](col, n, value, sel);
+}
@@ -0,0 +1,22 @@
+#ifndef MINIDB_FILTER_KERNELS_H_
+#define MINIDB_FILTER_KERNELS_H_
+
+// Filter Kernels, the comparisons of a where over a column of values
+#define FILTER_SCALAR 0
+#define FILTER_SSE2 1
+#define FILTER_AVX2 2
+
+// Compare the n values of col with value by sign_type (SIGN_EQ, ...) and clear bit i of sel,
+// bit i % 64 of sel[i / 64], for every value i that does not satisfy it, so the wheres of a
+// statement are ANDed by running their kernels over the same sel one after the other.
+// The comparisons are the ones of TKey, so <= is !(a > b) and >= is !(a < b) also for NaN
+void FilterInts(const int *col, int n, int sign_type, int value, unsigned long long *sel);
+void FilterFloats(const float *col, int n, int sign_type, float value, unsigned long long *sel);
+
+// The kernels are picked once by what the CPU supports, AVX2 over SSE2 over plain C++
+int filter_kernel();
+const char *FilterKernelName(int kernel);
+// Use the given kernels instead, false if the CPU does not support them
+bool SetFilterKernel(int kernel);
+
+#endif /* MINIDB_FILTER_KERNELS_H_ */
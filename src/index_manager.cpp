@@ -1,5 +1,6 @@
 #include "index_manager.h"
 
+#include <cstring>
 #include <fstream>
 #include <iostream>
 
@@ -35,7 +36,7 @@ void IndexManager::CreateIndex(SQLCreateIndex &st) {
   ofs.close();
 
   Index idx(st.index_name(), st.col_name(), attr->data_type(), attr->length(),
-            (4 * 1024 - 12) / (4 + attr->length()) / 2 - 1);
+            (hdl_->page_size() - 12) / (4 + attr->length()) / 2 - 1);
 
   tbl->AddIndex(idx);
 
@@ -47,7 +48,7 @@ void IndexManager::CreateIndex(SQLCreateIndex &st) {
 
   int block_num = tbl->first_block_num();
   for (int i = 0; i < tbl->block_count(); ++i) {
-    BlockInfo *bp = rm->GetBlockInfo(tbl, block_num);
+    BlockGuard bp(hdl_, rm->GetBlockInfo(tbl, block_num));
 
     for (int j = 0; j < bp->GetRecordCount(); ++j) {
       vector<TKey> tkey_value = rm->GetRecord(tbl, block_num, j);
@@ -67,10 +68,20 @@ void IndexManager::CreateIndex(SQLCreateIndex &st) {
 
 //=======================BPlusTree=======================//
 
+// Releases the nodes touched by one public operation of the tree when it returns,
+// so their blocks are only pinned while the operation runs
+class NodeScope {
+private:
+  BPlusTree *tree_;
+
+public:
+  NodeScope(BPlusTree *tree) : tree_(tree) {}
+  ~NodeScope() { tree_->ReleaseNodes(); }
+};
+
 void BPlusTree::InitTree() {
-  BPlusTreeNode *root_node =
-      new BPlusTreeNode(true, this, GetNewBlockNum(), true);
-  idx_->set_root(0);
+  BPlusTreeNode *root_node = NewNode(true, GetNewBlockNum(), true);
+  idx_->set_root(root_node->block_num());
   idx_->set_leaf_head(idx_->root());
   idx_->set_key_count(0);
   idx_->set_node_count(1);
@@ -79,6 +90,7 @@ void BPlusTree::InitTree() {
 }
 
 bool BPlusTree::Add(TKey &key, int block_num, int offset) {
+  NodeScope scope(this);
   int value = (block_num << 16) | offset;
 
   if (idx_->root() == -1) {
@@ -109,7 +121,7 @@ bool BPlusTree::AdjustAfterAdd(int node) {
   int parent = pnode->GetParent();
 
   if (parent == -1) {
-    BPlusTreeNode *newroot = new BPlusTreeNode(true, this, GetNewBlockNum());
+    BPlusTreeNode *newroot = NewNode(true, GetNewBlockNum());
     if (newroot == NULL)
       return false;
 
@@ -195,17 +207,46 @@ FindNodeParam BPlusTree::SearchBranch(int node, TKey &key) {
   return ret;
 }
 
-BPlusTreeNode *BPlusTree::GetNode(int num) {
-  BPlusTreeNode *pnode = new BPlusTreeNode(false, this, num);
+// Every node is kept in nodes_ and freed by ReleaseNodes, which unpins its block
+BPlusTreeNode *BPlusTree::NewNode(bool isnew, int blocknum, bool newleaf) {
+  BPlusTreeNode *pnode = new BPlusTreeNode(isnew, this, blocknum, newleaf);
+  nodes_.push_back(pnode);
   return pnode;
 }
 
+BPlusTreeNode *BPlusTree::GetNode(int num) { return NewNode(false, num); }
+
+// Free one node early, e.g. a child which only gets its parent updated
+void BPlusTree::ReleaseNode(BPlusTreeNode *node) {
+  for (int i = nodes_.size() - 1; i >= 0; --i) {
+    if (nodes_[i] == node) {
+      nodes_.erase(nodes_.begin() + i);
+      delete node;
+      return;
+    }
+  }
+}
+
+void BPlusTree::ReleaseNodes() {
+  for (unsigned int i = 0; i < nodes_.size(); ++i) {
+    delete nodes_[i];
+  }
+  nodes_.clear();
+}
+
+void BPlusTree::SetParentOf(int num, int parent) {
+  BPlusTreeNode *pnode = GetNode(num);
+  pnode->SetParent(parent);
+  ReleaseNode(pnode);
+}
+
 void BPlusTree::Print() {
   printf("*****************************************************\n");
   printf("KeyCount: %d, NodeCount: %d, Level: %d, Root: %d \n",
          idx_->key_count(), idx_->node_count(), idx_->level(), idx_->root());
 
   if (idx_->root() != -1) {
+    NodeScope scope(this);
     PrintNode(idx_->root());
   }
 }
@@ -214,16 +255,25 @@ void BPlusTree::PrintNode(int num) {
   BPlusTreeNode *pnode = GetNode(num);
 
   pnode->Print();
+  std::vector<int> children;
   if (!pnode->GetIsLeaf()) {
-
     for (int i = 0; i <= pnode->GetCount(); i++) {
-      PrintNode(pnode->GetValues(i));
+      children.push_back(pnode->GetValues(i));
     }
   }
+  ReleaseNode(pnode); // only one node of the tree is pinned at a time while printing
+
+  for (unsigned int i = 0; i < children.size(); i++) {
+    PrintNode(children[i]);
+  }
 }
 
 int BPlusTree::GetVal(TKey key) {
+  NodeScope scope(this);
   int ret = -1;
+  if (idx_->root() == -1) { // index created on an empty table
+    return ret;
+  }
   FindNodeParam fnp = Search(idx_->root(), key);
   if (fnp.flag) {
     ret = fnp.pnode->GetValues(fnp.index);
@@ -231,7 +281,20 @@ int BPlusTree::GetVal(TKey key) {
   return ret;
 }
 
+bool BPlusTree::SetVal(TKey key, int block_num, int offset) {
+  NodeScope scope(this);
+  if (idx_->root() == -1) {
+    return false;
+  }
+  FindNodeParam fnp = Search(idx_->root(), key);
+  if (fnp.flag) {
+    fnp.pnode->SetValues(fnp.index, (block_num << 16) | offset);
+  }
+  return fnp.flag;
+}
+
 bool BPlusTree::Remove(TKey key) {
+  NodeScope scope(this);
 
   if (idx_->root() == -1)
     return false;
@@ -273,12 +336,11 @@ bool BPlusTree::AdjustAfterRemove(int node) {
     if (pnode->GetCount() == 0) {
       if (!pnode->GetIsLeaf()) {
         idx_->set_root(pnode->GetValues(0));
-        GetNode(pnode->GetValues(0))->SetParent(-1);
+        SetParentOf(pnode->GetValues(0), -1);
       } else {
         idx_->set_root(-1);
         idx_->set_leaf_head(-1);
       }
-      delete pnode;
       idx_->DecreaseNodeCount();
       idx_->DecreaseLevel();
     }
@@ -290,7 +352,8 @@ bool BPlusTree::AdjustAfterRemove(int node) {
   int pos;
 
   pparent = GetNode(pnode->GetParent());
-  pparent->Search(pnode->GetKeys(0), pos);
+  TKey first = pnode->GetKeys(0);
+  pparent->Search(first, pos);
 
   if (pos == pparent->GetCount()) {
     pbrother = GetNode(pparent->GetValues(pos - 1));
@@ -299,10 +362,7 @@ bool BPlusTree::AdjustAfterRemove(int node) {
 
       if (pnode->GetIsLeaf()) {
 
-        for (int i = pnode->GetCount(); i > 0; i--) {
-          pnode->SetKeys(i, pnode->GetKeys(i - 1));
-          pnode->SetValues(i, pnode->GetValues(i - 1));
-        }
+        pnode->MoveEntries(1, 0, pnode->GetCount());
 
         pnode->SetKeys(0, pbrother->GetKeys(pbrother->GetCount() - 1));
         pnode->SetValues(0, pbrother->GetValues(pbrother->GetCount() - 1));
@@ -316,12 +376,7 @@ bool BPlusTree::AdjustAfterRemove(int node) {
         return true;
       } else {
 
-        for (int i = pnode->GetCount(); i > 0; i--) {
-          pnode->SetKeys(i, pnode->GetKeys(i - 1));
-        }
-        for (int i = pnode->GetCount() + 1; i > 0; i--) {
-          pnode->SetValues(i, pnode->GetValues(i - 1));
-        }
+        pnode->MoveEntries(1, 0, pnode->GetCount() + 1); // keys 0.. and values 0..count
 
         pnode->SetKeys(0, pparent->GetKeys(pos - 1));
         pparent->SetKeys(pos - 1, pbrother->GetKeys(pbrother->GetCount() - 1));
@@ -331,8 +386,8 @@ bool BPlusTree::AdjustAfterRemove(int node) {
 
         if (pbrother->GetValues(pbrother->GetCount()) >= 0) {
 
-          GetNode(pbrother->GetValues(pbrother->GetCount()))
-              ->SetParent(pnode->block_num());
+          SetParentOf(pbrother->GetValues(pbrother->GetCount()),
+                      pnode->block_num());
           pbrother->SetValues(pbrother->GetCount(), -1);
         }
         pbrother->SetCount(pbrother->GetCount() - 1);
@@ -344,15 +399,13 @@ bool BPlusTree::AdjustAfterRemove(int node) {
         pparent->RemoveAt(pos - 1);
         pparent->SetValues(pos - 1, pbrother->block_num());
 
+        pbrother->CopyEntries(pbrother->GetCount(), pnode, 0, pnode->GetCount());
         for (int i = 0; i < pnode->GetCount(); i++) {
-          pbrother->SetKeys(pbrother->GetCount() + i, pnode->GetKeys(i));
-          pbrother->SetValues(pbrother->GetCount() + i, pnode->GetValues(i));
           pnode->SetValues(i, -1);
         }
 
         pbrother->SetCount(pbrother->GetCount() + pnode->GetCount());
         pbrother->SetNextLeaf(pnode->GetNextLeaf());
-        delete pnode;
         idx_->DecreaseNodeCount();
 
         return AdjustAfterRemove(pparent->block_num());
@@ -361,18 +414,13 @@ bool BPlusTree::AdjustAfterRemove(int node) {
         pbrother->SetCount(pbrother->GetCount() + 1);
         pparent->RemoveAt(pos - 1);
         pparent->SetValues(pos - 1, pbrother->block_num());
-        for (int i = 0; i < pnode->GetCount(); i++) {
-          pbrother->SetKeys(pbrother->GetCount() + i, pnode->GetKeys(i));
-        }
-
+        pbrother->CopyEntries(pbrother->GetCount(), pnode, 0, pnode->GetCount() + 1); // keys and values 0..count
         for (int i = 0; i <= pnode->GetCount(); i++) {
-          pbrother->SetValues(pbrother->GetCount() + i, pnode->GetValues(i));
-          GetNode(pnode->GetValues(i))->SetParent(pbrother->block_num());
+          SetParentOf(pnode->GetValues(i), pbrother->block_num());
         }
 
         pbrother->SetCount(2 * idx_->rank());
 
-        delete pnode;
         idx_->DecreaseNodeCount();
 
         return AdjustAfterRemove(pparent->block_num());
@@ -400,7 +448,7 @@ bool BPlusTree::AdjustAfterRemove(int node) {
         pnode->SetValues(pnode->GetCount() + 1, pbrother->GetValues(0));
         pnode->SetCount(pnode->GetCount() + 1);
         pparent->SetKeys(pos, pbrother->GetKeys(0));
-        GetNode(pbrother->GetValues(0))->SetParent(pnode->block_num());
+        SetParentOf(pbrother->GetValues(0), pnode->block_num());
 
         pbrother->RemoveAt(0);
         return true;
@@ -409,15 +457,13 @@ bool BPlusTree::AdjustAfterRemove(int node) {
 
       if (pnode->GetIsLeaf()) {
 
+        pnode->CopyEntries(pnode->GetCount(), pbrother, 0, idx_->rank());
         for (int i = 0; i < idx_->rank(); i++) {
-
-          pnode->SetKeys(pnode->GetCount() + i, pbrother->GetKeys(i));
-          pnode->SetValues(pnode->GetCount() + i, pbrother->GetValues(i));
           pbrother->SetValues(i, -1);
         }
 
         pnode->SetCount(pnode->GetCount() + idx_->rank());
-        delete pbrother;
+        pnode->SetNextLeaf(pbrother->GetNextLeaf());
         idx_->DecreaseNodeCount();
 
         pparent->RemoveAt(pos);
@@ -432,17 +478,12 @@ bool BPlusTree::AdjustAfterRemove(int node) {
         pparent->SetValues(pos, pnode->block_num());
 
         pnode->SetCount(pnode->GetCount() + 1);
-        for (int i = 0; i < idx_->rank(); i++) {
-          pnode->SetKeys(pnode->GetCount() + i, pbrother->GetKeys(i));
-        }
-
+        pnode->CopyEntries(pnode->GetCount(), pbrother, 0, idx_->rank() + 1); // keys and values 0..rank
         for (int i = 0; i <= idx_->rank(); i++) {
-          pnode->SetValues(pnode->GetCount() + i, pbrother->GetValues(i));
-          GetNode(pbrother->GetValues(i))->SetParent(pnode->block_num());
+          SetParentOf(pbrother->GetValues(i), pnode->block_num());
         }
 
         pnode->SetCount(pnode->GetCount() + idx_->rank());
-        delete pbrother;
         idx_->DecreaseNodeCount();
 
         return AdjustAfterRemove(pparent->block_num());
@@ -451,11 +492,99 @@ bool BPlusTree::AdjustAfterRemove(int node) {
   }
 }
 
+//=======================BPlusTreeIterator=======================//
+
+void KeyRange::Restrict(int sign_type, TKey &key) {
+  bool inclusive = sign_type == SIGN_LE || sign_type == SIGN_GE;
+  if (sign_type == SIGN_GT || sign_type == SIGN_GE) {
+    if (!has_lower || key > lower) {
+      has_lower = true;
+      lower = key;
+      lower_inclusive = inclusive;
+    } else if (key == lower && !inclusive) {
+      lower_inclusive = false;
+    }
+  } else if (sign_type == SIGN_LT || sign_type == SIGN_LE) {
+    if (!has_upper || key < upper) {
+      has_upper = true;
+      upper = key;
+      upper_inclusive = inclusive;
+    } else if (key == upper && !inclusive) {
+      upper_inclusive = false;
+    }
+  }
+}
+
+bool KeyRange::Below(TKey &key) {
+  return has_lower && (key < lower || (!lower_inclusive && key == lower));
+}
+
+bool KeyRange::Beyond(TKey &key) {
+  return has_upper && (key > upper || (!upper_inclusive && key == upper));
+}
+
+void BPlusTreeIterator::Seek() {
+  Close();
+  if (tree_->idx()->root() == -1) { // the tree is empty
+    return;
+  }
+
+  int leaf_num = tree_->idx()->leaf_head();
+  if (range_.has_lower) {
+    NodeScope scope(tree_);
+    FindNodeParam fnp = tree_->Search(tree_->idx()->root(), range_.lower);
+    leaf_num = fnp.pnode->block_num();
+  }
+  leaf_ = tree_->GetNode(leaf_num);
+  index_ = 0;
+
+  // the leaf of the lower bound may still start with smaller keys
+  while (leaf_ != NULL && index_ < leaf_->GetCount()) {
+    TKey k = leaf_->GetKeys(index_);
+    if (!range_.Below(k)) {
+      break;
+    }
+    index_++;
+  }
+  Settle();
+}
+
+void BPlusTreeIterator::Next() {
+  if (leaf_ != NULL) {
+    index_++;
+    Settle();
+  }
+}
+
+void BPlusTreeIterator::Settle() {
+  while (leaf_ != NULL && index_ >= leaf_->GetCount()) {
+    int next = leaf_->GetNextLeaf();
+    Close();
+    if (next != -1) {
+      leaf_ = tree_->GetNode(next);
+      index_ = 0;
+    }
+  }
+  if (leaf_ != NULL) {
+    TKey k = leaf_->GetKeys(index_);
+    if (range_.Beyond(k)) {
+      Close();
+    }
+  }
+}
+
+void BPlusTreeIterator::Close() {
+  if (leaf_ != NULL) {
+    tree_->ReleaseNode(leaf_);
+    leaf_ = NULL;
+  }
+}
+
 //=======================BPlusTreeNode=======================//
 
 BPlusTreeNode::BPlusTreeNode(bool isnew, BPlusTree *tree, int blocknum,
                              bool newleaf)
-    : tree_(tree) {
+    : tree_(tree), modified_(false) {
   is_leaf_ = newleaf;
   rank_ = (tree_->degree() - 1) / 2;
   block_num_ = blocknum;
@@ -508,113 +637,97 @@ int BPlusTreeNode::GetNodeType() {
 int BPlusTreeNode::GetCount() { return *((int *)(&buffer_[4])); }
 
 void BPlusTreeNode::SetKeys(int index, TKey key) {
+  modified_ = true;
   int base = 12;
   int lenr = 4 + tree_->idx()->key_len();
   memcpy(&buffer_[base + index * lenr + 4], key.key(), tree_->idx()->key_len());
 }
 
 void BPlusTreeNode::SetValues(int index, int val) {
+  modified_ = true;
   int base = 12;
   int lenr = 4 + tree_->idx()->key_len();
   *((int *)(&buffer_[base + index * lenr])) = val;
 }
 
 void BPlusTreeNode::SetNextLeaf(int val) {
+  modified_ = true;
   int base = 12;
   int len = 4 + tree_->idx()->key_len();
   *((int *)(&buffer_[base + tree_->degree() * len])) = val;
 }
 
-void BPlusTreeNode::SetParent(int val) { *((int *)(&buffer_[8])) = val; }
+void BPlusTreeNode::SetParent(int val) {
+  modified_ = true;
+  *((int *)(&buffer_[8])) = val;
+}
 
-void BPlusTreeNode::SetNodeType(int val) { *((int *)(&buffer_[0])) = val; }
+void BPlusTreeNode::SetNodeType(int val) {
+  modified_ = true;
+  *((int *)(&buffer_[0])) = val;
+}
 
-void BPlusTreeNode::SetCount(int val) { *((int *)(&buffer_[4])) = val; }
+void BPlusTreeNode::SetCount(int val) {
+  modified_ = true;
+  *((int *)(&buffer_[4])) = val;
+}
 
 void BPlusTreeNode::SetIsLeaf(bool val) { SetNodeType(val ? 1 : 0); }
 
 void BPlusTreeNode::GetBuffer() {
-  BlockInfo *block = tree_->hdl()->GetFileBlock(
-      tree_->db_name(), tree_->idx()->name(), FORMAT_INDEX, block_num_);
-  buffer_ = block->data();
-  block->set_dirty(true);
+  block_ = tree_->hdl()->PinFileBlock(tree_->file_id(), block_num_);
+  buffer_ = block_->data();
 }
 
-bool BPlusTreeNode::Search(TKey key, int &index) {
-  bool ret = false;
-
-  if (GetCount() == 0) {
-    index = 0;
-    return false;
+// <0, 0 or >0 as key i of the node is less than, equal to or greater than key, read in place
+int BPlusTreeNode::CompareKey(int i, TKey &key) {
+  const char *k = Entry(i) + 4;
+  switch (tree_->idx()->key_type()) {
+  case T_INT: {
+    int a, b;
+    memcpy(&a, k, 4);
+    memcpy(&b, key.key(), 4);
+    return a < b ? -1 : (a > b ? 1 : 0);
+  }
+  case T_FLOAT: {
+    float a, b;
+    memcpy(&a, k, 4);
+    memcpy(&b, key.key(), 4);
+    return a < b ? -1 : (a > b ? 1 : 0);
+  }
+  default:
+    return strncmp(k, key.key(), tree_->idx()->key_len());
   }
+}
 
-  if (GetKeys(0) > key) {
-    index = 0;
-    return false;
+// Binary search: true and the index of key if the node has it, else false and the index of the first greater key
+bool BPlusTreeNode::Search(TKey &key, int &index) {
+  int low = 0;
+  int high = GetCount();
+  while (low < high) {
+    int m = (low + high) / 2;
+    if (CompareKey(m, key) < 0) {
+      low = m + 1;
+    } else {
+      high = m;
+    }
   }
+  index = low;
+  return low < GetCount() && CompareKey(low, key) == 0;
+}
 
-  if (GetKeys(GetCount() - 1) < key) {
-    index = GetCount();
-    return false;
+// Entry i holds value i and then key i, so moving entries moves keys and values together in one memmove
+void BPlusTreeNode::MoveEntries(int to, int from, int count) {
+  if (count > 0) {
+    modified_ = true;
+    memmove(Entry(to), Entry(from), count * (4 + tree_->idx()->key_len()));
   }
+}
 
-  if (GetCount() > 20) { // do binary search
-    int m, s, e;
-    s = 0;
-    e = GetCount() - 1;
-    while (s < e) {
-      m = (s + e) / 2;
-
-      if (key == GetKeys(m)) {
-        index = m;
-        return true;
-      } else if (key < GetKeys(m)) {
-        e = m;
-      } else {
-        s = m;
-      }
-
-      if (s == e - 1) {
-        if (key == GetKeys(s)) {
-          index = s;
-          return true;
-        }
-
-        if (key == GetKeys(e)) {
-          index = e;
-          return true;
-        }
-
-        if (key < GetKeys(s)) {
-          index = s;
-          return false;
-        }
-
-        if (key < GetKeys(e)) {
-          index = e;
-          return false;
-        }
-
-        if (key > GetKeys(e)) {
-          index = e + 1;
-          return false;
-        }
-      }
-    }
-    return false;
-  } else { // do sequential search
-    for (int i = 0; i < GetCount(); i++) {
-      if (key < GetKeys(i)) {
-        index = i;
-        ret = false;
-        break;
-      } else if (key == GetKeys(i)) {
-        index = i;
-        ret = true;
-        break;
-      }
-    }
-    return ret;
+void BPlusTreeNode::CopyEntries(int to, BPlusTreeNode *src, int from, int count) {
+  if (count > 0) {
+    modified_ = true;
+    memcpy(Entry(to), src->Entry(from), count * (4 + tree_->idx()->key_len()));
   }
 }
 
@@ -627,14 +740,7 @@ int BPlusTreeNode::Add(TKey &key) {
   }
 
   if (!Search(key, index)) {
-
-    for (int i = GetCount(); i > index; i--) {
-      SetKeys(i, GetKeys(i - 1));
-    }
-
-    for (int i = GetCount() + 1; i > index; i--) {
-      SetValues(i, GetValues(i - 1));
-    }
+    MoveEntries(index + 1, index, GetCount() - index + 1); // keys index.. and values index..count
 
     SetKeys(index, key);
     SetValues(index, -1);
@@ -653,11 +759,7 @@ int BPlusTreeNode::Add(TKey &key, int &val) {
   }
 
   if (!Search(key, index)) {
-
-    for (int i = GetCount(); i > index; i--) {
-      SetKeys(i, GetKeys(i - 1));
-      SetValues(i, GetValues(i - 1));
-    }
+    MoveEntries(index + 1, index, GetCount() - index);
 
     SetKeys(index, key);
     SetValues(index, val);
@@ -668,7 +770,7 @@ int BPlusTreeNode::Add(TKey &key, int &val) {
 
 BPlusTreeNode *BPlusTreeNode::Split(TKey &key) {
   BPlusTreeNode *newnode =
-      new BPlusTreeNode(true, tree_, tree_->GetNewBlockNum(), GetIsLeaf());
+      tree_->NewNode(true, tree_->GetNewBlockNum(), GetIsLeaf());
   if (newnode == NULL) {
     throw BPlusTreeException();
     return NULL;
@@ -677,10 +779,7 @@ BPlusTreeNode *BPlusTreeNode::Split(TKey &key) {
   key = GetKeys(rank_);
 
   if (GetIsLeaf()) {
-    for (int i = rank_ + 1; i < tree_->degree(); i++) {
-      newnode->SetKeys(i - rank_ - 1, GetKeys(i));
-      newnode->SetValues(i - rank_ - 1, GetValues(i));
-    }
+    newnode->CopyEntries(0, this, rank_ + 1, tree_->degree() - rank_ - 1);
 
     newnode->SetCount(rank_);
     SetCount(rank_ + 1);
@@ -689,22 +788,12 @@ BPlusTreeNode *BPlusTreeNode::Split(TKey &key) {
     newnode->SetParent(GetParent());
 
   } else {
-    for (int i = rank_ + 1; i < tree_->degree(); i++) {
-      newnode->SetKeys(i - rank_ - 1, GetKeys(i));
-    }
-    for (int i = rank_ + 1; i <= tree_->degree(); i++) {
-      newnode->SetValues(i - rank_ - 1, GetValues(i));
-    }
+    newnode->CopyEntries(0, this, rank_ + 1, tree_->degree() - rank_); // keys and values rank_ + 1..degree
     newnode->SetParent(GetParent());
     newnode->SetCount(rank_);
 
-    int childnode_num;
     for (int i = 0; i <= newnode->GetCount(); i++) {
-      childnode_num = newnode->GetValues(i);
-      BPlusTreeNode *node = tree_->GetNode(childnode_num);
-      if (node) {
-        node->SetParent(newnode->block_num());
-      }
+      tree_->SetParentOf(newnode->GetValues(i), newnode->block_num());
     }
 
     SetCount(rank_);
@@ -719,19 +808,9 @@ bool BPlusTreeNode::RemoveAt(int index) {
   }
 
   if (GetIsLeaf()) {
-
-    for (int i = index; i < GetCount() - 1; i++) {
-      SetKeys(i, GetKeys(i + 1));
-      SetValues(i, GetValues(i + 1));
-    }
+    MoveEntries(index, index + 1, GetCount() - 1 - index);
   } else {
-    for (int i = index; i < GetCount() - 1; i++) {
-      SetKeys(i, GetKeys(i + 1));
-    }
-
-    for (int i = index; i < GetCount(); i++) {
-      SetValues(i, GetValues(i + 1));
-    }
+    MoveEntries(index, index + 1, GetCount() - index); // keys index + 1.. and values index + 1..count
   }
   SetCount(GetCount() - 1);
   return true;
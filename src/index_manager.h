@@ -2,6 +2,7 @@
 #define MINIDB_INDEX_MANAGER_H_
 
 #include <string>
+#include <vector>
 
 #include "buffer_manager.h"
 #include "catalog_manager.h"
@@ -39,6 +40,8 @@ private:
   BufferManager *hdl_;
   CatalogManager *cm_;
   std::string db_name_;
+  int file_id_; // file id of the index file inside hdl_
+  std::vector<BPlusTreeNode *> nodes_; // nodes of the running operation, their blocks stay pinned until ReleaseNodes
 
 public:
   BPlusTree(Index *idx, BufferManager *hdl, CatalogManager *cm,
@@ -48,14 +51,16 @@ public:
     idx_ = idx;
     degree_ = 2 * idx_->rank() + 1;
     db_name_ = db_name;
+    file_id_ = hdl_->GetFileId(db_name_, idx_->name(), FORMAT_INDEX);
   }
-  ~BPlusTree() {}
+  ~BPlusTree() { ReleaseNodes(); }
 
   Index *idx() { return idx_; }
   int degree() { return degree_; }
   BufferManager *hdl() { return hdl_; }
   CatalogManager *cm() { return cm_; }
   std::string db_name() { return db_name_; }
+  int file_id() { return file_id_; }
 
   bool Add(TKey &key, int block_num, int offset);
   bool AdjustAfterAdd(int node);
@@ -65,8 +70,13 @@ public:
 
   FindNodeParam Search(int node, TKey &key);
   FindNodeParam SearchBranch(int node, TKey &key);
+  BPlusTreeNode *NewNode(bool isnew, int blocknum, bool newleaf = false);
   BPlusTreeNode *GetNode(int num);
+  void ReleaseNode(BPlusTreeNode *node);
+  void ReleaseNodes();
+  void SetParentOf(int num, int parent);
   int GetVal(TKey key);
+  bool SetVal(TKey key, int block_num, int offset); // the record of key has moved
 
   int GetNewBlockNum() { return idx_->IncreaseMaxCount(); }
 
@@ -82,16 +92,24 @@ private:
   BPlusTree *tree_;
   int block_num_;
   int rank_;
+  BlockInfo *block_; // pinned while the node lives
   char *buffer_;
   bool is_leaf_;
   bool is_new_node_;
+  bool modified_; // by a setter, the block is marked dirty when the node is released
 
 public:
   BPlusTreeNode(bool isnew, BPlusTree *tree, int blocknum,
                 bool newleaf = false);
-  ~BPlusTreeNode() {}
+  ~BPlusTreeNode() {
+    if (modified_) {
+      tree_->hdl()->WriteBlock(block_);
+    }
+    tree_->hdl()->UnpinBlock(block_);
+  }
 
   int block_num() { return block_num_; }
+  char *Entry(int i) { return buffer_ + 12 + i * (4 + tree_->idx()->key_len()); } // value i, then key i
 
   TKey GetKeys(int i);
   int GetValues(int i);
@@ -111,7 +129,10 @@ public:
 
   void GetBuffer();
 
-  bool Search(TKey key, int &index);
+  int CompareKey(int i, TKey &key);
+  bool Search(TKey &key, int &index);
+  void MoveEntries(int to, int from, int count); // count entries, overlapping or not
+  void CopyEntries(int to, BPlusTreeNode *src, int from, int count);
   int Add(TKey &key);
   int Add(TKey &key, int &val);
   BPlusTreeNode *Split(TKey &key);
@@ -127,4 +148,48 @@ public:
   void Print();
 };
 
+// The keys between lower and upper, a bound that is not set leaves the range open on its side
+struct KeyRange {
+  bool has_lower;
+  bool lower_inclusive;
+  TKey lower;
+  bool has_upper;
+  bool upper_inclusive;
+  TKey upper;
+
+  KeyRange(int key_type, int key_len)
+      : has_lower(false), lower_inclusive(true), lower(key_type, key_len),
+        has_upper(false), upper_inclusive(true), upper(key_type, key_len) {}
+  // Narrows the range to the keys k with k sign_type key, for SIGN_LT, SIGN_GT, SIGN_LE and SIGN_GE
+  void Restrict(int sign_type, TKey &key);
+  bool Below(TKey &key);  // key is left of the range
+  bool Beyond(TKey &key); // key is right of the range
+};
+
+// The entries of a tree with their keys in a range, in the order of the keys.
+// Seek goes down the tree to the first leaf that may hold the lower bound, or starts at the
+// leftmost leaf, and the entries are then read leaf after leaf through the next leaf links
+// until the upper bound. Only the leaf the iterator is on stays pinned
+class BPlusTreeIterator {
+private:
+  BPlusTree *tree_;
+  KeyRange range_;
+  BPlusTreeNode *leaf_; // NULL once the range is done
+  int index_;
+
+  void Settle(); // moves to the next entry in the range from index_ of leaf_ on
+
+public:
+  BPlusTreeIterator(BPlusTree *tree, const KeyRange &range)
+      : tree_(tree), range_(range), leaf_(NULL), index_(0) {}
+  ~BPlusTreeIterator() { Close(); }
+
+  void Seek();
+  bool Valid() { return leaf_ != NULL; }
+  TKey key() { return leaf_->GetKeys(index_); }
+  int value() { return leaf_->GetValues(index_); } // (block_num << 16) | offset of the record
+  void Next();
+  void Close();
+};
+
 #endif
@@ -14,9 +14,9 @@
 
 using namespace std;
 
-Interpreter::Interpreter() : sql_type_(-1) {
+Interpreter::Interpreter(BufferOptions options) : sql_type_(-1) {
   string p = boost::filesystem::current_path().parent_path().string() + "/MiniDatabase/";
-  api = new MiniDBAPI(p);
+  api = new MiniDBAPI(p, options);
 }
 
 Interpreter::~Interpreter() { delete api; }
@@ -101,6 +101,10 @@ void Interpreter::TellSQLType() {
     } else if (sql_vector_[1] == "tables") {
       cout << "SQL TYPE: #SHOW TABLES#" << endl;
       sql_type_ = 41;
+    } else if (sql_vector_[1] == "buffer" && sql_vector_.size() > 2 &&
+               boost::algorithm::to_lower_copy(sql_vector_[2]) == "stats") {
+      cout << "SQL TYPE: #SHOW BUFFER STATS#" << endl;
+      sql_type_ = 42;
     } else {
       sql_type_ = -1;
     }
@@ -136,6 +140,12 @@ void Interpreter::TellSQLType() {
   } else if (sql_vector_[0] == "update") {
     cout << "SQL TYPE: #UPDATE#" << endl;
     sql_type_ = 110;
+  } else if (sql_vector_[0] == "set") {
+    cout << "SQL TYPE: #SET#" << endl;
+    sql_type_ = 120;
+  } else if (sql_vector_[0] == "load") {
+    cout << "SQL TYPE: #LOAD DATA#" << endl;
+    sql_type_ = 130;
   } else {
     sql_type_ = -1;
     cout << "SQL TYPE: #UNKNOWN#" << endl;
@@ -173,6 +183,9 @@ void Interpreter::Run() {
     case 41: {
       api->ShowTables();
     } break;
+    case 42: {
+      api->ShowBufferStats();
+    } break;
     case 50: {
       SQLDropDatabase *st = new SQLDropDatabase(sql_vector_);
       api->DropDatabase(*st);
@@ -229,6 +242,16 @@ void Interpreter::Run() {
       api->Update(*st);
       delete st;
     } break;
+    case 120: {
+      SQLSet *st = new SQLSet(sql_vector_);
+      api->Set(*st);
+      delete st;
+    } break;
+    case 130: {
+      SQLLoad *st = new SQLLoad(sql_vector_);
+      api->Load(*st);
+      delete st;
+    } break;
     default:
       break;
     }
@@ -256,6 +279,18 @@ void Interpreter::Run() {
     cerr << "Index must be created on primary key!" << endl;
   } catch (PrimaryKeyConflictException &e) {
     cerr << "Primary key conflicts!" << endl;
+  } catch (BufferPoolExhaustedException &e) {
+    cerr << "Buffer pool exhausted, all blocks are pinned!" << endl;
+  } catch (InvalidValueException &e) {
+    cerr << "Invalid value!" << endl;
+  } catch (FileNotExistException &e) {
+    cerr << "File doesn't exist!" << endl;
+  } catch (AttributeNotExistException &e) {
+    cerr << "Attribute doesn't exist!" << endl;
+  } catch (IndexPositionOverflowException &e) {
+    cerr << "Table too large for its index!" << endl;
+  } catch (ValueCountMismatchException &e) {
+    cerr << "Value count doesn't match attribute count!" << endl;
   }
 }
 
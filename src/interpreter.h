@@ -17,7 +17,7 @@ private:
   void Run();
 
 public:
-  Interpreter();
+  Interpreter(BufferOptions options);
   ~Interpreter();
   void ExecSQL(std::string statement);
 };
@@ -0,0 +1,276 @@
+#include "io_backend.h"
+
+#include <errno.h>
+#include <sched.h>
+#include <linux/io_uring.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <iostream>
+
+#include "commons.h"
+
+using namespace std;
+
+IOBackend *IOBackend::Create(int kind) {
+  if (kind == IO_URING) {
+    UringBackend *uring = new UringBackend();
+    if (uring->ok()) {
+      return uring;
+    }
+    delete uring;
+    cerr << "io_uring is not available, using sync I/O" << endl;
+  }
+  return new SyncBackend();
+}
+
+void IOBackend::Execute(IORequest &req) {
+  if (req.op == IO_OP_READ) {
+    for (unsigned int i = 0; i < req.blocks.size(); ++i) {
+      req.blocks[i]->ReadInfo();
+    }
+  } else {
+    BlockInfo::WriteRun(req.blocks);
+  }
+  if (req.done != NULL) {
+    req.done(req, req.arg);
+  }
+}
+
+void IOBackend::Finish(IORequest &req, long result) {
+  if (req.op == IO_OP_READ) {
+    if (result < 0) {
+      cerr << "Failed to read block " << req.blocks[0]->block_num() << " of "
+           << req.blocks[0]->file()->file_name() << endl;
+      result = 0;
+    }
+    for (unsigned int i = 0; i < req.blocks.size(); ++i) { // zero what lies past the end of the file
+      BlockInfo *bp = req.blocks[i];
+      if (result < bp->size()) {
+        memset(bp->data() + result, 0, bp->size() - result);
+        result = 0;
+      } else {
+        result -= bp->size();
+      }
+    }
+  } else {
+    long bytes = 0;
+    for (unsigned int i = 0; i < req.blocks.size(); ++i) {
+      bytes += req.blocks[i]->size();
+    }
+    if (result != bytes) {
+      for (unsigned int i = 0; i < req.blocks.size(); ++i) {
+        req.blocks[i]->WriteInfo();
+      }
+    }
+  }
+  if (req.done != NULL) {
+    req.done(req, req.arg);
+  }
+}
+
+void SyncBackend::Submit(vector<IORequest> &batch) {
+  for (unsigned int i = 0; i < batch.size(); ++i) {
+    Execute(batch[i]);
+  }
+}
+
+UringBackend::UringBackend()
+    : ring_fd_(-1), sq_ring_(MAP_FAILED), cq_ring_(MAP_FAILED),
+      sq_ring_bytes_(0), cq_ring_bytes_(0), sqes_((struct io_uring_sqe *)MAP_FAILED),
+      sqes_bytes_(0), entries_(0) {
+  if (!Setup()) {
+    Teardown();
+  }
+}
+
+UringBackend::~UringBackend() { Teardown(); }
+
+// The rings are shared with the kernel through three mappings of the ring fd (two if it has IORING_FEAT_SINGLE_MMAP)
+bool UringBackend::Setup() {
+  struct io_uring_params p;
+  memset(&p, 0, sizeof(p));
+  ring_fd_ = syscall(__NR_io_uring_setup, IO_QUEUE_DEPTH, &p);
+  if (ring_fd_ < 0) {
+    ring_fd_ = -1;
+    return false;
+  }
+
+  sq_ring_bytes_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  cq_ring_bytes_ = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    if (cq_ring_bytes_ > sq_ring_bytes_) {
+      sq_ring_bytes_ = cq_ring_bytes_;
+    }
+    cq_ring_bytes_ = sq_ring_bytes_;
+  }
+  sq_ring_ = mmap(NULL, sq_ring_bytes_, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (sq_ring_ == MAP_FAILED) {
+    return false;
+  }
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    cq_ring_ = sq_ring_;
+  } else {
+    cq_ring_ = mmap(NULL, cq_ring_bytes_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+    if (cq_ring_ == MAP_FAILED) {
+      return false;
+    }
+  }
+  sqes_bytes_ = p.sq_entries * sizeof(struct io_uring_sqe);
+  sqes_ = (struct io_uring_sqe *)mmap(NULL, sqes_bytes_, PROT_READ | PROT_WRITE,
+                                      MAP_SHARED | MAP_POPULATE, ring_fd_,
+                                      IORING_OFF_SQES);
+  if (sqes_ == MAP_FAILED) {
+    return false;
+  }
+
+  char *sq = (char *)sq_ring_;
+  sq_head_ = (unsigned *)(sq + p.sq_off.head);
+  sq_tail_ = (unsigned *)(sq + p.sq_off.tail);
+  sq_mask_ = (unsigned *)(sq + p.sq_off.ring_mask);
+  sq_array_ = (unsigned *)(sq + p.sq_off.array);
+  char *cq = (char *)cq_ring_;
+  cq_head_ = (unsigned *)(cq + p.cq_off.head);
+  cq_tail_ = (unsigned *)(cq + p.cq_off.tail);
+  cq_mask_ = (unsigned *)(cq + p.cq_off.ring_mask);
+  cqes_ = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+  entries_ = p.sq_entries;
+  return true;
+}
+
+void UringBackend::Teardown() {
+  if (sqes_ != MAP_FAILED) {
+    munmap(sqes_, sqes_bytes_);
+    sqes_ = (struct io_uring_sqe *)MAP_FAILED;
+  }
+  if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_bytes_);
+  }
+  cq_ring_ = MAP_FAILED;
+  if (sq_ring_ != MAP_FAILED) {
+    munmap(sq_ring_, sq_ring_bytes_);
+    sq_ring_ = MAP_FAILED;
+  }
+  if (ring_fd_ != -1) {
+    close(ring_fd_);
+    ring_fd_ = -1;
+  }
+}
+
+bool UringBackend::Queue(IORequest &req) {
+  unsigned tail = *sq_tail_;
+  if (tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) == entries_) {
+    return false;
+  }
+
+  req.iov.resize(req.blocks.size());
+  for (unsigned int i = 0; i < req.blocks.size(); ++i) {
+    req.iov[i].iov_base = req.blocks[i]->data();
+    req.iov[i].iov_len = req.blocks[i]->size();
+  }
+  BlockInfo *first = req.blocks[0];
+
+  unsigned index = tail & *sq_mask_;
+  struct io_uring_sqe *sqe = &sqes_[index];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = req.op == IO_OP_READ ? IORING_OP_READV : IORING_OP_WRITEV;
+  sqe->fd = first->file()->fd();
+  sqe->addr = (unsigned long)&req.iov[0];
+  sqe->len = req.iov.size();
+  sqe->off = (unsigned long)first->block_num() * first->size();
+  sqe->user_data = (unsigned long)&req;
+  sq_array_[index] = index;
+  __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+int UringBackend::Reap() {
+  int count = 0;
+  unsigned head = *cq_head_;
+  while (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+    struct io_uring_cqe *cqe = &cqes_[head & *cq_mask_];
+    IORequest *req = (IORequest *)cqe->user_data;
+    long result = cqe->res;
+    head++;
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE); // the entry is copied out, give it back before the callback
+    Finish(*req, result);
+    count++;
+  }
+  return count;
+}
+
+// The requests own their iovecs and the kernel reads into or writes from their blocks until they complete,
+// so they must all have completed before Submit returns, even if io_uring_enter stops working.
+// Completions land in the ring whenever the kernel returns to this thread, so it is polled until then
+void UringBackend::Drain(unsigned int count) {
+  while (count > 0) {
+    int ret = syscall(__NR_io_uring_enter, ring_fd_, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+    if (ret < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+      sched_yield();
+    }
+    count -= Reap();
+  }
+}
+
+// Keep the submission queue full, and submit and wait in one system call until the whole batch has completed
+void UringBackend::Submit(vector<IORequest> &batch) {
+  if (!ok()) { // given up after a failure
+    SyncBackend().Submit(batch);
+    return;
+  }
+  unsigned int next = 0;
+  unsigned int queued = 0;   // in the submission queue, not yet handed to the kernel
+  unsigned int in_flight = 0; // queued or submitted, not yet completed
+  while (next < batch.size() || in_flight > 0) {
+    while (next < batch.size()) {
+      IORequest &req = batch[next];
+      if (req.blocks[0]->mapped()) { // nothing to read, and msync for a write
+        Execute(req);
+        next++;
+        continue;
+      }
+      if (!Queue(req)) {
+        break;
+      }
+      next++;
+      queued++;
+      in_flight++;
+    }
+    if (in_flight == 0) {
+      break;
+    }
+
+    int ret = syscall(__NR_io_uring_enter, ring_fd_, queued, 1,
+                      IORING_ENTER_GETEVENTS, NULL, 0);
+    if (ret < 0) {
+      if (errno == EINTR || errno == EAGAIN || errno == EBUSY) { // retried once completions are reaped
+        in_flight -= Reap();
+        continue;
+      }
+      // take back what the kernel has not seen, wait for what it has, and finish the batch with sync I/O.
+      // The ring is not used again
+      cerr << "io_uring_enter failed: " << strerror(errno) << ", using sync I/O" << endl;
+      __atomic_store_n(sq_tail_, *sq_tail_ - queued, __ATOMIC_RELEASE);
+      Drain(in_flight - queued);
+      Teardown();
+      unsigned int first = next;
+      while (queued > 0) {
+        if (!batch[--first].blocks[0]->mapped()) {
+          queued--;
+        }
+      }
+      for (; first < batch.size(); ++first) {
+        if (!batch[first].blocks[0]->mapped() || first >= next) {
+          Execute(batch[first]);
+        }
+      }
+      return;
+    }
+    queued -= ret;
+    in_flight -= Reap();
+  }
+}
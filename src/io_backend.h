@@ -0,0 +1,87 @@
+#ifndef MINIDB_IO_BACKEND_H_
+#define MINIDB_IO_BACKEND_H_
+
+#include <sys/uio.h>
+
+#include <vector>
+
+#include "block_info.h"
+
+#define IO_OP_READ 0
+#define IO_OP_WRITE 1
+
+// Entries of the submission queue of one io_uring
+#define IO_QUEUE_DEPTH 64
+
+struct IORequest;
+typedef void (*IOCallback)(IORequest &req, void *arg);
+
+// A read or a write of consecutive blocks of one file, done is called with arg once it has completed
+struct IORequest {
+  int op; // IO_OP_READ or IO_OP_WRITE
+  std::vector<BlockInfo *> blocks;
+  IOCallback done; // may be NULL
+  void *arg;
+  std::vector<struct iovec> iov; // filled by the backend
+
+  IORequest(int o, IOCallback cb, void *a) : op(o), done(cb), arg(a) {}
+};
+
+// The page I/O of one shard of the buffer, only used under the latch of the shard.
+// Submit hands a batch of requests to the backend and returns once every request has completed and its callback has run.
+// Like BlockInfo::ReadInfo/WriteInfo, a read past the end of the file gives zeroed blocks, a failed write is
+// written again block by block, which reports the failing block, and mapped blocks (mmap storage) are never read or written
+class IOBackend {
+protected:
+  static void Execute(IORequest &req); // with BlockInfo::ReadInfo/WriteRun, then the callback
+  static void Finish(IORequest &req, long result); // result of the preadv/pwritev of req, then the callback
+
+public:
+  virtual ~IOBackend() {}
+  virtual void Submit(std::vector<IORequest> &batch) = 0;
+  virtual bool batched() = 0; // many requests in flight at once, so reading ahead into the buffer pays off
+  virtual const char *name() = 0;
+
+  static IOBackend *Create(int kind); // IO_SYNC or IO_URING, falls back to IO_SYNC if the kernel has no io_uring
+};
+
+// One pread/pwritev after the other
+class SyncBackend : public IOBackend {
+public:
+  void Submit(std::vector<IORequest> &batch);
+  bool batched() { return false; }
+  const char *name() { return "sync"; }
+};
+
+// io_uring through its system calls: the whole batch is queued as READV/WRITEV entries,
+// up to IO_QUEUE_DEPTH of them in flight, and one io_uring_enter both submits and waits for completions
+class UringBackend : public IOBackend {
+private:
+  int ring_fd_;
+  void *sq_ring_;
+  void *cq_ring_;
+  long sq_ring_bytes_;
+  long cq_ring_bytes_;
+  struct io_uring_sqe *sqes_;
+  long sqes_bytes_;
+  unsigned *sq_head_, *sq_tail_, *sq_mask_, *sq_array_;
+  unsigned *cq_head_, *cq_tail_, *cq_mask_;
+  struct io_uring_cqe *cqes_;
+  unsigned entries_;
+
+  bool Setup();
+  void Teardown();
+  bool Queue(IORequest &req); // false if the submission queue is full
+  int Reap();                 // completes the requests in the completion queue, returns how many
+  void Drain(unsigned int count); // waits until count submitted requests have completed
+
+public:
+  UringBackend();
+  ~UringBackend();
+  bool ok() { return ring_fd_ != -1; }
+  void Submit(std::vector<IORequest> &batch);
+  bool batched() { return true; }
+  const char *name() { return "io_uring"; }
+};
+
+#endif /* MINIDB_IO_BACKEND_H_ */
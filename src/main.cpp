@@ -5,14 +5,214 @@
 #include <readline/history.h>
 #include <readline/readline.h>
 
+#include "filter_kernels.h"
 #include "interpreter.h"
+#include "record_manager.h"
 
 using namespace std;
 
+void SetReplacer(BufferOptions &options, string name) {
+  boost::algorithm::to_lower(name);
+  if (name == "lru") {
+    options.replacer = REPLACER_LRU;
+  } else if (name == "clock") {
+    options.replacer = REPLACER_CLOCK;
+  } else if (name == "2q") {
+    options.replacer = REPLACER_2Q;
+  } else {
+    cerr << "Unknown replacer: " << name << ", using 2q" << endl;
+    options.replacer = REPLACER_2Q;
+  }
+}
+
+void SetStorage(BufferOptions &options, string name) {
+  boost::algorithm::to_lower(name);
+  if (name == "buffered") {
+    options.storage = STORAGE_BUFFERED;
+  } else if (name == "mmap") {
+    options.storage = STORAGE_MMAP;
+  } else {
+    cerr << "Unknown storage: " << name << ", using buffered" << endl;
+    options.storage = STORAGE_BUFFERED;
+  }
+}
+
+void SetIO(BufferOptions &options, string name) {
+  boost::algorithm::to_lower(name);
+  if (name == "sync") {
+    options.io = IO_SYNC;
+  } else if (name == "uring" || name == "io_uring") {
+    options.io = IO_URING;
+  } else {
+    cerr << "Unknown I/O backend: " << name << ", using sync" << endl;
+    options.io = IO_SYNC;
+  }
+}
+
+void SetPoolPages(BufferOptions &options, string value) {
+  int pages = atoi(value.c_str());
+  if (pages < MIN_POOL_PAGES) {
+    cerr << "Invalid buffer pool size: " << value << ", using "
+         << options.pool_pages << " pages" << endl;
+  } else {
+    options.pool_pages = pages;
+  }
+}
+
+void SetFlushInterval(BufferOptions &options, string value) {
+  int ms = atoi(value.c_str());
+  if (ms < 0 || (ms == 0 && value != "0")) {
+    cerr << "Invalid flush interval: " << value << ", using "
+         << options.flush_interval_ms << " ms" << endl;
+  } else {
+    options.flush_interval_ms = ms;
+  }
+}
+
+void SetDirtyRatio(BufferOptions &options, string value) {
+  double ratio = atof(value.c_str());
+  if (ratio <= 0 || ratio > 1) {
+    cerr << "Invalid dirty ratio: " << value << ", using "
+         << options.dirty_ratio << endl;
+  } else {
+    options.dirty_ratio = ratio;
+  }
+}
+
+void SetReadAhead(BufferOptions &options, string value) {
+  int pages = atoi(value.c_str());
+  if (pages < 0 || (pages == 0 && value != "0")) {
+    cerr << "Invalid read-ahead size: " << value << ", using "
+         << options.read_ahead_pages << " pages" << endl;
+  } else {
+    options.read_ahead_pages = pages;
+  }
+}
+
+void SetShards(BufferOptions &options, string value) {
+  int shards = atoi(value.c_str());
+  if (shards < 0 || (shards == 0 && value != "0")) {
+    cerr << "Invalid number of buffer shards: " << value
+         << ", using one per core" << endl;
+  } else {
+    options.shards = shards;
+  }
+}
+
+void SetFilter(string name) {
+  boost::algorithm::to_lower(name);
+  int kernel = name == "avx2" ? FILTER_AVX2 : (name == "sse2" ? FILTER_SSE2 : FILTER_SCALAR);
+  if ((kernel == FILTER_SCALAR && name != "scalar") || !SetFilterKernel(kernel)) {
+    cerr << "Unsupported filter kernels: " << name << ", using "
+         << FilterKernelName(filter_kernel()) << endl;
+  }
+}
+
+void SetScanThreads(string value) {
+  int threads = atoi(value.c_str());
+  if (threads < 0 || (threads == 0 && value != "0")) {
+    cerr << "Invalid number of scan threads: " << value << ", using one per core" << endl;
+  } else {
+    RecordManager::set_scan_threads(threads);
+  }
+}
+
+// Read the buffer options, the command line overrides the environment
+//   MINIDB_REPLACER=2q|lru|clock          --replacer=2q|lru|clock
+//   MINIDB_BUFFER_POOL_PAGES=N            --buffer-pool-pages=N
+//   MINIDB_BUFFER_SHARDS=N                --buffer-shards=N (0 = one per core)
+//   MINIDB_STORAGE=buffered|mmap          --storage=buffered|mmap
+//   MINIDB_IO=sync|uring                  --io=sync|uring
+//   MINIDB_HUGE_PAGES=1                   --huge-pages
+//   MINIDB_FLUSH_INTERVAL_MS=N            --flush-interval-ms=N
+//   MINIDB_DIRTY_RATIO=R                  --dirty-ratio=R
+//   MINIDB_READ_AHEAD_PAGES=N             --read-ahead-pages=N
+// and the filter kernels of the scans, picked by the CPU unless given, and the threads of a full scan
+//   MINIDB_FILTER=scalar|sse2|avx2        --filter=scalar|sse2|avx2
+//   MINIDB_SCAN_THREADS=N                 --scan-threads=N (0 = one per core, 1 = no parallel scans)
+BufferOptions ReadBufferOptions(int argc, const char *argv[]) {
+  BufferOptions options;
+
+  const char *env = getenv("MINIDB_REPLACER");
+  if (env != NULL) {
+    SetReplacer(options, env);
+  }
+  env = getenv("MINIDB_STORAGE");
+  if (env != NULL) {
+    SetStorage(options, env);
+  }
+  env = getenv("MINIDB_IO");
+  if (env != NULL) {
+    SetIO(options, env);
+  }
+  env = getenv("MINIDB_BUFFER_POOL_PAGES");
+  if (env != NULL) {
+    SetPoolPages(options, env);
+  }
+  env = getenv("MINIDB_BUFFER_SHARDS");
+  if (env != NULL) {
+    SetShards(options, env);
+  }
+  env = getenv("MINIDB_FLUSH_INTERVAL_MS");
+  if (env != NULL) {
+    SetFlushInterval(options, env);
+  }
+  env = getenv("MINIDB_DIRTY_RATIO");
+  if (env != NULL) {
+    SetDirtyRatio(options, env);
+  }
+  env = getenv("MINIDB_READ_AHEAD_PAGES");
+  if (env != NULL) {
+    SetReadAhead(options, env);
+  }
+  env = getenv("MINIDB_HUGE_PAGES");
+  if (env != NULL) {
+    options.huge_pages = atoi(env) != 0;
+  }
+  env = getenv("MINIDB_FILTER");
+  if (env != NULL) {
+    SetFilter(env);
+  }
+  env = getenv("MINIDB_SCAN_THREADS");
+  if (env != NULL) {
+    SetScanThreads(env);
+  }
+
+  for (int i = 1; i < argc; ++i) {
+    string arg(argv[i]);
+    if (arg.compare(0, 11, "--replacer=") == 0) {
+      SetReplacer(options, arg.substr(11));
+    } else if (arg.compare(0, 10, "--storage=") == 0) {
+      SetStorage(options, arg.substr(10));
+    } else if (arg.compare(0, 5, "--io=") == 0) {
+      SetIO(options, arg.substr(5));
+    } else if (arg.compare(0, 20, "--buffer-pool-pages=") == 0) {
+      SetPoolPages(options, arg.substr(20));
+    } else if (arg.compare(0, 16, "--buffer-shards=") == 0) {
+      SetShards(options, arg.substr(16));
+    } else if (arg.compare(0, 20, "--flush-interval-ms=") == 0) {
+      SetFlushInterval(options, arg.substr(20));
+    } else if (arg.compare(0, 14, "--dirty-ratio=") == 0) {
+      SetDirtyRatio(options, arg.substr(14));
+    } else if (arg.compare(0, 19, "--read-ahead-pages=") == 0) {
+      SetReadAhead(options, arg.substr(19));
+    } else if (arg == "--huge-pages") {
+      options.huge_pages = true;
+    } else if (arg.compare(0, 9, "--filter=") == 0) {
+      SetFilter(arg.substr(9));
+    } else if (arg.compare(0, 15, "--scan-threads=") == 0) {
+      SetScanThreads(arg.substr(15));
+    } else {
+      cerr << "Unknown option: " << arg << endl;
+    }
+  }
+  return options;
+}
+
 int main(int argc, const char *argv[]) {
 
   string sql;
-  Interpreter itp;
+  Interpreter itp(ReadBufferOptions(argc, argv));
 
   char *line;
   size_t found;
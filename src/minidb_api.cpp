@@ -9,12 +9,16 @@
 
 #include "catalog_manager.h"
 #include "exceptions.h"
+#include "filter_kernels.h"
 #include "index_manager.h"
 #include "record_manager.h"
 
 using namespace std;
 
-MiniDBAPI::MiniDBAPI(std::string p) : path_(p) { cm_ = new CatalogManager(p); }
+MiniDBAPI::MiniDBAPI(std::string p, BufferOptions options)
+    : path_(p), hdl_(NULL), options_(options) {
+  cm_ = new CatalogManager(p);
+}
 
 MiniDBAPI::~MiniDBAPI() {
   // hdl_ is initialized in #Use#
@@ -24,6 +28,9 @@ MiniDBAPI::~MiniDBAPI() {
 
 // Case 10
 void MiniDBAPI::Quit() {
+  if (hdl_ != NULL) {
+    hdl_->PrintStats();
+  }
   delete hdl_;
   delete cm_;
   std::cout << "Quiting..." << std::endl;
@@ -42,6 +49,7 @@ void MiniDBAPI::Help() {
   std::cout << "#DROP DATABASE#" << std::endl;
   std::cout << "#CREATE TABLE#" << std::endl;
   std::cout << "#SHOW TABLES#" << std::endl;
+  std::cout << "#SHOW BUFFER STATS#" << std::endl;
   std::cout << "#DROP TABLES#" << std::endl;
   std::cout << "#CREATE INDEX#" << std::endl;
   std::cout << "#DROP INDEX#" << std::endl;
@@ -49,6 +57,9 @@ void MiniDBAPI::Help() {
   std::cout << "#INSERT#" << std::endl;
   std::cout << "#DELETE#" << std::endl;
   std::cout << "#UPDATE#" << std::endl;
+  std::cout << "#SET#" << std::endl;
+  std::cout << "#LOAD DATA#" << std::endl;
+  std::cout << "Filter kernels: " << FilterKernelName(filter_kernel()) << std::endl;
 }
 
 // Case 30
@@ -63,6 +74,14 @@ void MiniDBAPI::CreateDatabase(SQLCreateDatabase &st) {
     throw DatabaseAlreadyExistsException();
   }
 
+  int page_size = st.page_size();
+  if (page_size < PAGE_SIZE_MIN || page_size > PAGE_SIZE_MAX ||
+      (page_size & (page_size - 1)) != 0) {
+    std::cout << "The page size must be a power of two from " << PAGE_SIZE_MIN
+              << " to " << PAGE_SIZE_MAX << std::endl;
+    throw InvalidValueException();
+  }
+
   if (boost::filesystem::exists(folder_path)) {
     boost::filesystem::remove_all(folder_path);
     std::cout << "Database folder exists and deleted!" << std::endl;
@@ -71,7 +90,7 @@ void MiniDBAPI::CreateDatabase(SQLCreateDatabase &st) {
   boost::filesystem::create_directories(folder_path);
   std::cout << "Database folder created!" << std::endl;
 
-  cm_->CreateDatabase(st.db_name());
+  cm_->CreateDatabase(st.db_name(), page_size);
   std::cout << "Catalog written!" << std::endl;
   cm_->WriteArchiveFile();
 }
@@ -92,6 +111,16 @@ void MiniDBAPI::CreateTable(SQLCreateTable &st) {
     throw TableAlreadyExistsException();
   }
 
+  int record_length = 0;
+  for (unsigned int i = 0; i < st.attrs().size(); ++i) {
+    record_length += st.attrs()[i].length();
+  }
+  if (record_length > db->page_size() - 12) { // a row never spans two blocks
+    std::cout << "A row of " << record_length << " bytes does not fit in a page of "
+              << db->page_size() << " bytes" << std::endl;
+    throw InvalidValueException();
+  }
+
   std::string file_name(path_ + curr_db_ + "/" + st.tb_name() + ".records");
   boost::filesystem::path folder_path(file_name);
 
@@ -158,6 +187,14 @@ void MiniDBAPI::ShowTables() {
   }
 }
 
+// Case 42
+void MiniDBAPI::ShowBufferStats() {
+  if (hdl_ == NULL) { // the buffer is created in #USE#
+    throw NoDatabaseSelectedException();
+  }
+  hdl_->ShowStats();
+}
+
 // Case 50
 void MiniDBAPI::DropDatabase(SQLDropDatabase &st) {
   std::cout << "Dropping database: " << st.db_name() << std::endl;
@@ -194,6 +231,7 @@ void MiniDBAPI::DropDatabase(SQLDropDatabase &st) {
   if (st.db_name() == curr_db_) {
     curr_db_ = "";
     delete hdl_;
+    hdl_ = NULL;
   }
 }
 
@@ -215,6 +253,7 @@ void MiniDBAPI::DropTable(SQLDropTable &st) {
   }
 
   std::string file_name(path_ + curr_db_ + "/" + st.tb_name() + ".records"); // remove .records file
+  hdl_->DropFile(curr_db_, st.tb_name(), FORMAT_RECORD);
 
   if (!boost::filesystem::exists(file_name)) {
     std::cout << "Table file doesn't exist!" << std::endl;
@@ -227,6 +266,7 @@ void MiniDBAPI::DropTable(SQLDropTable &st) {
   for (int i = 0; i < tb->GetIndexNum(); ++i) {
     std::string file_name(path_ + curr_db_ + "/" + tb->GetIndex(i)->name() + // remove .index file
                           ".index");
+    hdl_->DropFile(curr_db_, tb->GetIndex(i)->name(), FORMAT_INDEX);
     if (!boost::filesystem::exists(file_name)) {
       std::cout << "Index file doesn't exist!" << std::endl;
     } else {
@@ -256,6 +296,7 @@ void MiniDBAPI::DropIndex(SQLDropIndex &st) {
   }
 
   std::string file_name(path_ + curr_db_ + "/" + st.idx_name() + ".index"); // remove .index file
+  hdl_->DropFile(curr_db_, st.idx_name(), FORMAT_INDEX);
 
   if (!boost::filesystem::exists(file_name)) {
     std::cout << "Index file doesn't exist!" << std::endl;
@@ -280,10 +321,12 @@ void MiniDBAPI::Use(SQLUse &st) {
   if (curr_db_.length() != 0) {
     std::cout << "Closing the old database: " << curr_db_ << std::endl;
     cm_->WriteArchiveFile();
+    hdl_->PrintStats();
     delete hdl_;
   }
   curr_db_ = st.db_name();
-  hdl_ = new BufferManager(path_); // Using the buffer
+  hdl_ = new BufferManager(path_, options_, db->page_size()); // Using the buffer
+  hdl_->PrintMemoryUsage();
 }
 
 // Case 70
@@ -361,4 +404,44 @@ void MiniDBAPI::Update(SQLUpdate &st) {
   RecordManager *rm = new RecordManager(cm_, hdl_, curr_db_);
   rm->Update(st);
   delete rm;
-}
\ No newline at end of file
+}
+
+// Case 120
+void MiniDBAPI::Set(SQLSet &st) {
+  if (st.name() != "buffer_pool_pages") {
+    throw SyntaxErrorException();
+  }
+
+  int pages = atoi(st.value().c_str());
+  // every shard needs MIN_POOL_PAGES, and the shards stay the same when resizing
+  int min_pages = hdl_ == NULL ? MIN_POOL_PAGES : hdl_->min_pool_pages();
+  if (pages < min_pages) {
+    std::cout << "The buffer pool needs at least " << min_pages << " pages"
+              << std::endl;
+    throw InvalidValueException();
+  }
+
+  options_.pool_pages = pages;
+  if (hdl_ == NULL) { // applied at the next #USE#
+    std::cout << "Buffer pool: " << pages << " pages" << std::endl;
+    return;
+  }
+  hdl_->Resize(pages);
+  hdl_->PrintMemoryUsage();
+}
+
+// Case 130
+void MiniDBAPI::Load(SQLLoad &st) {
+  if (curr_db_.length() == 0) {
+    throw NoDatabaseSelectedException();
+  }
+
+  Database *db = cm_->GetDB(curr_db_);
+  if (db == NULL) {
+    throw DatabaseNotExistException();
+  }
+
+  RecordManager *rm = new RecordManager(cm_, hdl_, curr_db_);
+  rm->Load(st);
+  delete rm;
+}
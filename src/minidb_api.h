@@ -12,10 +12,11 @@ private:
   std::string path_;
   CatalogManager *cm_;
   BufferManager *hdl_;
+  BufferOptions options_; // used for the BufferManager of every #USE#
   std::string curr_db_;
 
 public:
-  MiniDBAPI(std::string p);
+  MiniDBAPI(std::string p, BufferOptions options);
   ~MiniDBAPI();
   void Quit();  // Case 10
   void Help();  // Case 20
@@ -24,6 +25,7 @@ public:
   void CreateIndex(SQLCreateIndex &st);  // Case 32
   void ShowDatabases();  // Case 40
   void ShowTables();  // Case 41
+  void ShowBufferStats();  // Case 42
   void DropDatabase(SQLDropDatabase &st);  // Case 50
   void DropTable(SQLDropTable &st);  // Case 51
   void DropIndex(SQLDropIndex &st);  // Case 52
@@ -32,6 +34,8 @@ public:
   void Select(SQLSelect &st);  // Case 90
   void Delete(SQLDelete &st);  // Case 100
   void Update(SQLUpdate &st);  // Case 110
+  void Set(SQLSet &st);  // Case 120
+  void Load(SQLLoad &st);  // Case 130
 };
 
 #endif /* MINIDB_MINIDB_API_H_ */
@@ -1,27 +1,62 @@
 #include "record_manager.h"
 
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <thread>
+#include <unordered_set>
 
+#include "filter_kernels.h"
 #include "index_manager.h"
 
 using namespace std;
 
+int RecordManager::scan_threads_ = 0;
+
 // Get the block_info which matches your db_name_, tbl->tb_name() and block_num
-// Get the block_info from hdl (buffer) fhandle_
+// Get the block_info from hdl (buffer) fhandle_ using the file id of tbl's records file
 // if fhandle_ doesn't have one, then either get an empty block from bhandle_, or recycle the oldest block from fhandle_
 // and read from the memory of the corresponding db_name_, tbl->tb_name() and block_num
 BlockInfo* RecordManager::GetBlockInfo(Table *tbl, int block_num) {
   if (block_num == -1) {
     return NULL;
   }
-  BlockInfo *block = hdl_->GetFileBlock(db_name_, tbl->tb_name(), 0, block_num); // 0 here refers to the file type (0 means record, 1 means index)
+  if (tbl != file_tbl_) { // resolve the records file id once per table instead of on every block
+    file_tbl_ = tbl;
+    file_id_ = hdl_->GetFileId(db_name_, tbl->tb_name(), FORMAT_RECORD);
+  }
+  BlockInfo *block = hdl_->GetFileBlock(file_id_, block_num);
   return block;
 }
 
+// The bytes of the primary key as they compare in TKey, strings end at the first zero byte
+static string KeyOf(Attribute &attr, const char *key) {
+  if (attr.data_type() == T_CHAR) {
+    return string(key, strnlen(key, attr.length()));
+  }
+  if (attr.data_type() == T_FLOAT && *(float *)key == 0) { // -0 == 0
+    float zero = 0;
+    return string((char *)&zero, 4);
+  }
+  return string(key, 4);
+}
+
+// Orders the rows of one #INSERT# by their key for the index
+struct RowKeyLess {
+  vector<vector<TKey> > &rows;
+  int col;
+  RowKeyLess(vector<vector<TKey> > &r, int c) : rows(r), col(c) {}
+  bool operator()(int a, int b) { return rows[a][col] < rows[b][col]; }
+};
+
 void RecordManager::Insert(SQLInsert &st) {
   string tb_name = st.tb_name();
-  unsigned long values_size = st.values().size();
 
   Table *tbl = cm_->GetDB(db_name_)->GetTable(tb_name);
 
@@ -29,216 +64,223 @@ void RecordManager::Insert(SQLInsert &st) {
     throw TableNotExistException();
   }
 
-  int max_count = (4096 - 12) / (tbl->record_length()); // tbl->record_length() is total number of bytes for all attributes
+  int max_count = (hdl_->page_size() - 12) / (tbl->record_length()); // tbl->record_length() is total number of bytes for all attributes
   // max_count means the maximum number of rows that one block can fit
 
-  vector<TKey> tkey_values;
-  int pk_index = -1;
-
-  for (int i = 0; i < values_size; ++i) {
-    int value_type = st.values()[i].data_type;
-    string value = st.values()[i].value;
-    int length = tbl->ats()[i].length(); // tbl->ats() means table's attribute vector
-    // The length here is the number of bytes of the data
-    // if data_type_==0 or ==1 then length_==4, otherwise if it is a string then length depends on how it is defined
+  // every row must have a value for each attribute, checked before any row is read so nothing is inserted
+  for (unsigned int r = 0; r < st.rows().size(); ++r) {
+    if (st.rows()[r].size() != tbl->ats().size()) {
+      throw ValueCountMismatchException();
+    }
+  }
 
-    TKey tmp(value_type, length);
-    tmp.ReadValue(value.c_str());
-    tkey_values.push_back(tmp);
+  vector<vector<TKey> > rows;
+  int pk_index = -1;
 
-    if (tbl->ats()[i].attr_type() == 1) {
-      pk_index = i;
+  for (int r = 0; r < st.rows().size(); ++r) {
+    vector<SQLValue> &values = st.rows()[r];
+    rows.push_back(vector<TKey>());
+    for (int i = 0; i < values.size(); ++i) {
+      int value_type = values[i].data_type;
+      string value = values[i].value;
+      int length = tbl->ats()[i].length(); // tbl->ats() means table's attribute vector
+      // The length here is the number of bytes of the data
+      // if data_type_==0 or ==1 then length_==4, otherwise if it is a string then length depends on how it is defined
+
+      TKey tmp(value_type, length);
+      tmp.ReadValue(value.c_str());
+      rows.back().push_back(tmp);
+
+      if (tbl->ats()[i].attr_type() == 1) {
+        pk_index = i;
+      }
     }
   }
 
   // if there is a primary key
   // then of course need to check against PrimaryKeyConflictException
+  // for every row before any row is inserted, so a statement with a conflict inserts nothing
   if (pk_index != -1) {
+    Attribute &pk = tbl->ats()[pk_index];
+    unordered_set<string> keys; // of the rows of the statement, and of the table when it has no index
 
     if (tbl->GetIndexNum() != 0) { // Get the number of indices associated with this table
 
       BPlusTree tree(tbl->GetIndex(0), hdl_, cm_, db_name_);
 
-      int value = tree.GetVal(tkey_values[pk_index]);
-      if (value != -1) {
-        throw PrimaryKeyConflictException();
+      for (int r = 0; r < rows.size(); ++r) {
+        int value = tree.GetVal(rows[r][pk_index]);
+        if (value != -1) {
+          throw PrimaryKeyConflictException();
+        }
+      }
+    } else { // There is a primary key but doesn't have an index for this table, read the keys of the table once
+      int pk_offset = 0;
+      for (int i = 0; i < pk_index; ++i) {
+        pk_offset += tbl->ats()[i].length();
       }
-    } else { // There is a primary key but doesn't have an index for this table
       int block_num = tbl->first_block_num();
-      for (int i = 0; i < tbl->block_count(); ++i) {
-        BlockInfo* bp = GetBlockInfo(tbl, block_num);
+      for (int i = 0; i < tbl->block_count() && block_num != -1; ++i) {
+        BlockGuard bp(hdl_, GetBlockInfo(tbl, block_num));
 
+        char *content = bp->GetContentAddress() + pk_offset;
         for (int j = 0; j < bp->GetRecordCount(); ++j) {
-          vector<TKey> tkey_value = GetRecord(tbl, block_num, j);
-
-          if (tkey_value[pk_index] == tkey_values[pk_index]) {
-            throw PrimaryKeyConflictException();
-          }
+          keys.insert(KeyOf(pk, content));
+          content += tbl->record_length();
         }
 
         block_num = bp->GetNextBlockNum();
       }
     }
-  }
 
-  char *content;
-  int ub = tbl->first_block_num();    // used block
-  int frb = tbl->first_rubbish_num(); // first rubbish block
-  int lastub;
-  int blocknum, offset;
-
-  // I want you to first imagine a linkedlist of useful blocks which belong to the same file (double-way linkedlist)
-  // Arranging in block number, they are, e.g. 5 <-> 4 <-> 1 <-> 0. Not all useful blocks are full
-  // There is also another linkedlist of rubbish blocks, e.g. 2 -> 3 (single-way linkedlist)
-  // Now what the function is doing is that:
-  // First, it traverse across the useful linkedlist and see if there is any block that is not full yet. If so, then it fills the row into that block
-  // If all blocks in the useful linkedlist are filled then it does the following:
-  // If there exists rubbish block, then take the first rubbish block, in our case is block number 2, and append it to the end of the useful linkedlist
-  // So now our useful linkedlist (double-way) becomes 5 <-> 4 <-> 1 <-> 0 <-> 2 and our rubbish linkedlist (single-way) becomes 3
-  // The new inserted row will be inserted into block number 2. 
-  // If on the other hand there are no rubbish blocks, but since you still need to insert a new row
-  // So what you will do is add a new useful block to the front of the useful linkedlist
-  // So now the useful linkedlist (double-way) becomes 6 <-> 5 <-> 4 <-> 1 <-> 0 <-> 2 with the new row added into block number 6.
-
-  // First, it traverse across the useful linkedlist and see if there is any block that is not full yet. If so, then it fills the row into that block
-  while (ub != -1) { // keep traversing through the linkedlist of useful blocks
-    lastub = ub;     // lastup is used to record the last element of the useful linkedlist
-    BlockInfo *bp = GetBlockInfo(tbl, ub);
-    // if this block is filled, move on to the next block in the useful linkedlist
-    if (bp->GetRecordCount() == max_count) { // bp->GetRecordCount() means number of rows contained in this block
-      ub = bp->GetNextBlockNum();
-      continue;
-    }
-    content =
-        bp->GetContentAddress() + bp->GetRecordCount() * tbl->record_length();  
-        // bp->GetRecordCount() means number of rows contained in this block
-        // tbl->record_length() is total number of bytes for all attributes
-    for (vector<TKey>::iterator iter = tkey_values.begin();
-         iter != tkey_values.end(); ++iter) {
-      memcpy(content, iter->key(), iter->length());
-      content += iter->length();
-    }
-    bp->SetRecordCount(1 + bp->GetRecordCount()); // set the number of rows to +1
-
-    blocknum = ub;
-    offset = bp->GetRecordCount() - 1;
-
-    hdl_->WriteBlock(bp); // only setting bp to dirty
-
-    // add record to index
-    if (tbl->GetIndexNum() != 0) {
-      BPlusTree tree(tbl->GetIndex(0), hdl_, cm_, db_name_);
-      for (int i = 0; i < tbl->ats().size(); ++i) {
-        if (tbl->GetIndex(0)->attr_name() == tbl->GetIndex(i)->attr_name()) {
-          tree.Add(tkey_values[i], blocknum, offset);
-          break;
-        }
+    for (int r = 0; r < rows.size(); ++r) {
+      if (!keys.insert(KeyOf(pk, rows[r][pk_index].key())).second) {
+        throw PrimaryKeyConflictException();
       }
     }
-
-    hdl_->WriteToDisk();
-    cm_->WriteArchiveFile();
-
-    return;
   }
 
-  // Suppose our original useful linkedlist (double-way) is 5 <-> 4 <-> 1 <-> 0 and our original rubbish linkedlist (single-way) is 2 -> 3
-  // If all blocks in the useful linkedlist are filled then it does the following:
-
-  // If there exists rubbish block, then take the first rubbish block, in our case is block number 2, and append it to the end of the useful linkedlist
-  // So now our useful linkedlist (double-way) becomes 5 <-> 4 <-> 1 <-> 0 <-> 2 and our rubbish linkedlist (single-way) becomes 3
-  // The new inserted row will be inserted into block number 2. 
-
-  // Remember lastup is the last element of the original useful linkedlist, in our case, it is block number 0
-
-  if (frb != -1) { // if there is rubbish block in the table
-    BlockInfo *bp = GetBlockInfo(tbl, frb);
-    content = bp->GetContentAddress();
-    for (vector<TKey>::iterator iter = tkey_values.begin();
-         iter != tkey_values.end(); ++iter) {
-      memcpy(content, iter->key(), iter->length());
-      content += iter->length();
-    }
-    bp->SetRecordCount(1);
-
-    BlockInfo *lastubp = GetBlockInfo(tbl, lastub); // Remember lastup is the last element of the original useful linkedlist, in our case, it is block number 0
-    lastubp->SetNextBlockNum(frb);
-
-    tbl->set_first_rubbish_num(bp->GetNextBlockNum());
-
-    bp->SetPrevBlockNum(lastub);
-    bp->SetNextBlockNum(-1);
-
-    blocknum = frb;
-    offset = 0;
-
-    hdl_->WriteBlock(bp); // set bp as dirty
-    hdl_->WriteBlock(lastubp); // set lastubp as dirty
-
-  } 
-
-  // Suppose our original useful linkedlist (double-way) is 5 <-> 4 <-> 1 <-> 0 <-> 2 and our original rubbish linkedlist (single-way) is 3
+  if (!tbl->free_map_built()) { // table of an old catalog
+    BuildFreeMap(tbl, max_count);
+  }
 
-  // If on the other hand there are no rubbish blocks, but since you still need to insert a new row
-  // So what you will do is add a new useful block to the front of the useful linkedlist
-  // So now the useful linkedlist (double-way) becomes 6 <-> 5 <-> 4 <-> 1 <-> 0 <-> 2 with the new row added into block number 6.
+  // The rows are appended one after the other into the block from PinInsertBlock, and the next block is only
+  // taken once that block is full
+  vector<int> positions; // (block number << 16) | offset of every row, like the values of the index
+  BlockInfo *bp = NULL;
+  int blocknum = -1;
+  try {
+    for (int r = 0; r < rows.size(); ++r) {
+      if (bp == NULL || bp->GetRecordCount() == max_count) {
+        if (bp != NULL) {
+          hdl_->UnpinBlock(bp);
+        }
+        bp = PinInsertBlock(tbl, blocknum);
+      }
+      char *content =
+          bp->GetContentAddress() + bp->GetRecordCount() * tbl->record_length();
+          // bp->GetRecordCount() means number of rows contained in this block
+          // tbl->record_length() is total number of bytes for all attributes
+      for (vector<TKey>::iterator iter = rows[r].begin(); iter != rows[r].end();
+           ++iter) {
+        memcpy(content, iter->key(), iter->length());
+        content += iter->length();
+      }
+      bp->SetRecordCount(1 + bp->GetRecordCount()); // set the number of rows to +1
+      tbl->SetBlockFree(blocknum, bp->GetRecordCount() < max_count);
+      positions.push_back((blocknum << 16) | (bp->GetRecordCount() - 1));
 
-  else { // there is no rubbish block in the table
-    int next_block = tbl->first_block_num(); // get the head of the original useful linkedlist, in our case is block number 5
-    // If the useful linkedlist is not empty, i.e. if the head of the useful linkedlist is not -1
-    if (tbl->first_block_num() != -1) {
-      BlockInfo *upbp = GetBlockInfo(tbl, tbl->first_block_num());
-      upbp->SetPrevBlockNum(tbl->block_count()); // preparing to add a new block (block number 6) at the front of the useful linkedlist
-      hdl_->WriteBlock(upbp); // set upbp to dirty, since you have changed the value of byte index 0-3 in this block
+      hdl_->WriteBlock(bp); // only setting bp to dirty
     }
-    tbl->set_first_block_num(tbl->block_count()); // setting the head of the useful linkedlist (double-way) to be block number 6
-    BlockInfo* bp = GetBlockInfo(tbl, tbl->first_block_num());
-
-    bp->SetPrevBlockNum(-1);
-    bp->SetNextBlockNum(next_block);
-    bp->SetRecordCount(1);
-
-    content = bp->GetContentAddress();
-    for (vector<TKey>::iterator iter = tkey_values.begin();
-         iter != tkey_values.end(); ++iter) {
-      memcpy(content, iter->key(), iter->length());
-      content += iter->length();
+  } catch (...) {
+    if (bp != NULL) {
+      hdl_->UnpinBlock(bp);
     }
-
-    blocknum = tbl->block_count();
-    offset = 0;
-
-    hdl_->WriteBlock(bp); // set bp to dirty
-
-    tbl->IncreaseBlockCount();
+    throw;
+  }
+  if (bp != NULL) {
+    hdl_->UnpinBlock(bp);
   }
 
-  // add record to index
+  // add the records to index, in the order of their keys so that neighbouring keys go to the same leaves
   if (tbl->GetIndexNum() != 0) {
     BPlusTree tree(tbl->GetIndex(0), hdl_, cm_, db_name_);
     for (int i = 0; i < tbl->ats().size(); ++i) {
-      if (tbl->GetIndex(0)->attr_name() == tbl->GetIndex(i)->name()) {
-        tree.Add(tkey_values[i], blocknum, offset);
+      if (tbl->GetIndex(0)->attr_name() == tbl->ats()[i].attr_name()) {
+        vector<int> order(rows.size());
+        for (int r = 0; r < rows.size(); ++r) {
+          order[r] = r;
+        }
+        sort(order.begin(), order.end(), RowKeyLess(rows, i));
+        for (int r = 0; r < order.size(); ++r) {
+          int pos = positions[order[r]];
+          tree.Add(rows[order[r]][i], pos >> 16, pos & 0xFFFF);
+        }
         break;
       }
     }
   }
-  cm_->WriteArchiveFile();
-  hdl_->WriteToDisk();
+  cm_->WriteArchiveFile(); // once for the statement, the blocks are written back by the writer thread of hdl_
+}
+
+// Returns pinned the block the next row is inserted into
+// I want you to first imagine a linkedlist of useful blocks which belong to the same file (double-way linkedlist)
+// Arranging in block number, they are, e.g. 5 <-> 4 <-> 1 <-> 0. Not all useful blocks are full
+// There is also another linkedlist of rubbish blocks, e.g. 2 -> 3 (single-way linkedlist)
+// Now what the function is doing is that:
+// First, it asks the free-space map of the table for a useful block that is not full yet. If there is one, then the row goes into that block
+// If all blocks in the useful linkedlist are filled then it does the following:
+// If there exists rubbish block, then take the first rubbish block, in our case is block number 2, and add it to the front of the useful linkedlist
+// So now our useful linkedlist (double-way) becomes 2 <-> 5 <-> 4 <-> 1 <-> 0 and our rubbish linkedlist (single-way) becomes 3
+// The new inserted row will be inserted into block number 2. 
+// If on the other hand there are no rubbish blocks, but since you still need to insert a new row
+// So what you will do is add a new useful block to the front of the useful linkedlist
+// So now the useful linkedlist (double-way) becomes 6 <-> 2 <-> 5 <-> 4 <-> 1 <-> 0 with the new row added into block number 6.
+// None of this walks the useful linkedlist, so an insert reads at most the block it writes to and the head of the useful linkedlist
+BlockInfo *RecordManager::PinInsertBlock(Table *tbl, int &block_num) {
+  block_num = tbl->FindFreeBlock();
+  if (block_num != -1) {
+    BlockInfo *bp = GetBlockInfo(tbl, block_num);
+    hdl_->PinBlock(bp);
+    return bp;
+  }
+
+  if (tbl->first_rubbish_num() != -1) { // if there is rubbish block in the table
+    block_num = tbl->first_rubbish_num();
+  } else { // there is no rubbish block in the table
+    block_num = tbl->block_count();
+    tbl->IncreaseBlockCount();
+  }
+  BlockInfo *bp = GetBlockInfo(tbl, block_num);
+  hdl_->PinBlock(bp);
+  if (block_num == tbl->first_rubbish_num()) {
+    tbl->set_first_rubbish_num(bp->GetNextBlockNum());
+  }
+
+  int next_block = tbl->first_block_num(); // get the head of the original useful linkedlist, in our case is block number 5
+  // If the useful linkedlist is not empty, i.e. if the head of the useful linkedlist is not -1
+  if (next_block != -1) {
+    BlockGuard upbp(hdl_, GetBlockInfo(tbl, next_block));
+    upbp->SetPrevBlockNum(block_num); // the new block goes in front of it
+    hdl_->WriteBlock(upbp.get()); // set upbp to dirty, since you have changed the value of byte index 0-3 in this block
+  }
+  tbl->set_first_block_num(block_num); // setting the head of the useful linkedlist (double-way) to be the new block
+
+  bp->SetPrevBlockNum(-1);
+  bp->SetNextBlockNum(next_block);
+  bp->SetRecordCount(0);
+  hdl_->WriteBlock(bp); // set bp to dirty
+  return bp;
+}
+
+// Walk the chain of used blocks once and mark the ones which are not full
+void RecordManager::BuildFreeMap(Table *tbl, int max_count) {
+  int block_num = tbl->first_block_num();
+  for (int i = 0; i < tbl->block_count() && block_num != -1; ++i) {
+    BlockGuard bp(hdl_, GetBlockInfo(tbl, block_num));
+    tbl->SetBlockFree(block_num, bp->GetRecordCount() < max_count);
+    block_num = bp->GetNextBlockNum();
+  }
+  tbl->set_free_map_built(true);
 }
 
 void RecordManager::Select(SQLSelect &st) {
 
   Table *tbl = cm_->GetDB(db_name_)->GetTable(st.tb_name());
 
-  for (int i = 0; i < tbl->GetAttributeNum(); ++i) {
-    cout << setw(9) << left << tbl->ats()[i].attr_name();
+  vector<int> columns = BindColumns(tbl, st.col_names());
+  RecordLayout layout(tbl);
+  vector<Predicate> preds = BindWheres(layout, tbl, st.wheres());
+
+  for (int i = 0; i < columns.size(); ++i) {
+    cout << setw(9) << left << tbl->ats()[columns[i]].attr_name();
   }
   cout << endl;
 
-  vector<vector<TKey> > tkey_values;
+  ResultWriter writer(cout, columns);
 
   bool has_index = false;
+  bool has_range = false; // the key of the index is only restricted to a range
   int index_idx;
   int where_idx;
 
@@ -251,31 +293,42 @@ void RecordManager::Select(SQLSelect &st) {
             has_index = true;
             index_idx = i;
             where_idx = j;
+          } else if (st.wheres()[j].sign_type != SIGN_NE) {
+            has_range = true;
+            index_idx = i;
           }
         }
       }
     }
   }
 
-  // if no index
-  if (!has_index) {
+  int threads = scan_threads_ > 0 ? scan_threads_ : thread::hardware_concurrency();
+  threads = min(threads, (tbl->block_count() + SCAN_CHUNK_BLOCKS - 1) / SCAN_CHUNK_BLOCKS);
+
+  if (!has_index && has_range) { // the entries of the range in the index, in the order of the key
+    BPlusTree tree(tbl->GetIndex(index_idx), hdl_, cm_, db_name_);
+    BPlusTreeIterator it(&tree, BindRange(tbl->GetIndex(index_idx), st.wheres()));
+    for (it.Seek(); it.Valid(); it.Next()) {
+      int value = it.value();
+      BlockGuard bp(hdl_, GetBlockInfo(tbl, value >> 16));
+      RowView row(&layout, bp->GetContentAddress() + (value & 0xffff) * layout.record_length());
+      if (SatisfyWheres(preds, row)) {
+        writer.Write(row);
+      }
+    }
+  } else if (!has_index && threads > 1 && tbl->block_count() >= PARALLEL_SCAN_MIN_BLOCKS) { // if no index
+    ParallelScan(tbl, layout, preds, threads, writer);
+  } else if (!has_index) {
+    BlockFilter filter(preds);
     int block_num = tbl->first_block_num();
-    for (int i = 0; i < tbl->block_count(); ++i) {
-      BlockInfo *bp = GetBlockInfo(tbl, block_num);
+    for (int i = 0; i < tbl->block_count() && block_num != -1; ++i) { // rubbish blocks are counted in block_count() but are not in the chain
+      BlockGuard bp(hdl_, GetBlockInfo(tbl, block_num));
 
+      filter.Run(bp->GetContentAddress(), bp->GetRecordCount(), layout.record_length());
       for (int j = 0; j < bp->GetRecordCount(); ++j) {
-        vector<TKey> tkey_value = GetRecord(tbl, block_num, j);
-
-        bool sats = true;
-
-        for (int k = 0; k < st.wheres().size(); ++k) {
-          SQLWhere where = st.wheres()[k];
-          if (!SatisfyWhere(tbl, tkey_value, where)) {
-            sats = false;
-          }
-        }
-        if (sats) {
-          tkey_values.push_back(tkey_value);
+        if (filter.selected(j)) {
+          RowView row(&layout, bp->GetContentAddress() + j * layout.record_length());
+          writer.Write(row);
         }
       }
 
@@ -299,30 +352,99 @@ void RecordManager::Select(SQLSelect &st) {
       blocknum = blocknum >> 16;
       blocknum = blocknum & 0xffff;
       blockoffset = blockoffset & 0xffff;
-      vector<TKey> tkey_value = GetRecord(tbl, blocknum, blockoffset);
-      bool sats = true;
+      BlockGuard bp(hdl_, GetBlockInfo(tbl, blocknum));
+      RowView row(&layout, bp->GetContentAddress() + blockoffset * layout.record_length());
+      bool sats = SatisfyWheres(preds, row);
+      if (sats) {
+        writer.Write(row);
+      }
+    }
+  }
+  writer.Flush();
+  if (tbl->GetIndexNum() != 0) {
+    BPlusTree tree(tbl->GetIndex(0), hdl_, cm_, db_name_);
+    tree.Print();
+  }
+}
 
-      for (int k = 0; k < st.wheres().size(); ++k) {
-        SQLWhere where = st.wheres()[k];
-        if (!SatisfyWhere(tbl, tkey_value, where)) {
-          sats = false;
+// The threads take the next SCAN_CHUNK_BLOCKS blocks by block number until there are none left, filter them
+// with a BlockFilter each and format the records that qualify into the text of the block. The blocks of the
+// rubbish chain have no records, so going by block number finds the records of the chain of used blocks.
+// Meanwhile the calling thread follows the chain through the next block numbers the threads read and writes
+// the text of every block as soon as it is done, so the records come out in the order of a scan of the chain.
+// The blocks are fetched and pinned at once by PinFileBlock, since another thread may recycle a block in between
+void RecordManager::ParallelScan(Table *tbl, RecordLayout &layout, vector<Predicate> &preds,
+                                 int threads, ResultWriter &writer) {
+  int file_id = hdl_->GetFileId(db_name_, tbl->tb_name(), FORMAT_RECORD);
+  int blocks = tbl->block_count();
+  vector<string> found(blocks);
+  vector<int> next(blocks, -1);
+  vector<char> done(blocks, 0); // guarded by latch, like failed
+  mutex latch;
+  condition_variable cv;
+  bool failed = false;
+  atomic<int> next_chunk(0);
+  vector<exception_ptr> errors(threads);
+
+  vector<thread> workers;
+  for (int t = 0; t < threads; ++t) {
+    workers.push_back(thread([&, t] {
+      try {
+        BlockFilter filter(preds);
+        int chunk;
+        while ((chunk = next_chunk.fetch_add(SCAN_CHUNK_BLOCKS)) < blocks) {
+          for (int block_num = chunk; block_num < min(chunk + SCAN_CHUNK_BLOCKS, blocks); ++block_num) {
+            BlockInfo *bp = hdl_->PinFileBlock(file_id, block_num);
+            int next_num = bp->GetNextBlockNum();
+            filter.Run(bp->GetContentAddress(), bp->GetRecordCount(), layout.record_length());
+            for (int j = 0; j < bp->GetRecordCount(); ++j) {
+              if (filter.selected(j)) {
+                RowView row(&layout, bp->GetContentAddress() + j * layout.record_length());
+                writer.Format(row, found[block_num]);
+              }
+            }
+            hdl_->UnpinBlock(bp);
+            {
+              lock_guard<mutex> lock(latch);
+              next[block_num] = next_num;
+              done[block_num] = 1;
+            }
+            cv.notify_all();
+          }
+        }
+      } catch (...) {
+        errors[t] = current_exception();
+        next_chunk = blocks; // the others stop too
+        {
+          lock_guard<mutex> lock(latch);
+          failed = true;
         }
+        cv.notify_all();
       }
-      if (sats) {
-        tkey_values.push_back(tkey_value);
+    }));
+  }
+
+  int block_num = tbl->first_block_num();
+  for (int i = 0; i < blocks && block_num >= 0 && block_num < blocks; ++i) {
+    {
+      unique_lock<mutex> lock(latch);
+      cv.wait(lock, [&] { return done[block_num] || failed; });
+      if (failed) {
+        break;
       }
     }
+    writer.Write(found[block_num]);
+    string().swap(found[block_num]);
+    block_num = next[block_num];
   }
 
-  for (int i = 0; i < tkey_values.size(); ++i) {
-    for (int j = 0; j < tkey_values[i].size(); ++j) {
-      cout << setw(9) << left << tkey_values[i][j];
-    }
-    cout << endl;
+  for (int t = 0; t < threads; ++t) {
+    workers[t].join();
   }
-  if (tbl->GetIndexNum() != 0) {
-    BPlusTree tree(tbl->GetIndex(0), hdl_, cm_, db_name_);
-    tree.Print();
+  for (int t = 0; t < threads; ++t) {
+    if (errors[t]) {
+      rethrow_exception(errors[t]);
+    }
   }
 }
 
@@ -330,8 +452,11 @@ void RecordManager::Delete(SQLDelete &st) {
 
   Table *tbl = cm_->GetDB(db_name_)->GetTable(st.tb_name());
 
+  RecordLayout layout(tbl);
+  vector<Predicate> preds = BindWheres(layout, tbl, st.wheres());
   bool has_index = false;
-  int index_idx;
+  bool has_range = false; // the key of the index is only restricted to a range
+  int index_idx = 0; // a table has one index at most
   int where_idx;
 
   if (tbl->GetIndexNum() != 0) {
@@ -343,31 +468,51 @@ void RecordManager::Delete(SQLDelete &st) {
           if (st.wheres()[j].sign_type == SIGN_EQ) {
             has_index = true;
             where_idx = j;
+          } else if (st.wheres()[j].sign_type != SIGN_NE) {
+            has_range = true;
           }
         }
       }
     }
   }
 
-  // if no index
-  if (!has_index) {
-    int block_num = tbl->first_block_num();
-    for (int i = 0; i < tbl->block_count(); ++i) {
-      BlockInfo *bp = GetBlockInfo(tbl, block_num);
-      int count = bp->GetRecordCount();
-      for (int j = 0; j < count; ++j) {
-        vector<TKey> tkey_value = GetRecord(tbl, block_num, j);
-
-        bool sats = true;
-
-        for (int k = 0; k < st.wheres().size(); ++k) {
-          SQLWhere where = st.wheres()[k];
-          if (!SatisfyWhere(tbl, tkey_value, where)) {
-            sats = false;
-          }
+  if (!has_index && has_range) {
+    BPlusTree tree(tbl->GetIndex(index_idx), hdl_, cm_, db_name_);
+    int key_idx = tbl->GetAttributeIndex(tbl->GetIndex(index_idx)->attr_name());
+
+    // the keys to delete first, as deleting changes the tree under the iterator
+    vector<TKey> keys;
+    {
+      BPlusTreeIterator it(&tree, BindRange(tbl->GetIndex(index_idx), st.wheres()));
+      for (it.Seek(); it.Valid(); it.Next()) {
+        int value = it.value();
+        BlockGuard bp(hdl_, GetBlockInfo(tbl, value >> 16));
+        RowView row(&layout, bp->GetContentAddress() + (value & 0xffff) * layout.record_length());
+        if (SatisfyWheres(preds, row)) {
+          keys.push_back(row.GetKey(key_idx));
         }
+      }
+    }
+
+    // where each one is now, since a delete moves the last record of its block
+    for (int k = 0; k < keys.size(); ++k) {
+      int value = tree.GetVal(keys[k]);
+      if (value != -1) {
+        tree.Remove(keys[k]);
+        DeleteRecord(tbl, value >> 16, value & 0xffff);
+      }
+    }
+  } else if (!has_index) { // if no index
+    int block_num = tbl->first_block_num();
+    for (int i = 0; i < tbl->block_count() && block_num != -1; ++i) { // rubbish blocks are counted in block_count() but are not in the chain
+      BlockGuard bp(hdl_, GetBlockInfo(tbl, block_num));
+      int next_num = bp->GetNextBlockNum(); // an emptied block is moved to the rubbish chain
+      int j = 0;
+      while (j < bp->GetRecordCount()) {
+        RowView row(&layout, bp->GetContentAddress() + j * layout.record_length());
+
+        bool sats = SatisfyWheres(preds, row);
         if (sats) {
-          DeleteRecord(tbl, block_num, j);
           if (tbl->GetIndexNum() != 0) {
             BPlusTree tree(tbl->GetIndex(index_idx), hdl_, cm_, db_name_);
 
@@ -379,12 +524,15 @@ void RecordManager::Delete(SQLDelete &st) {
               }
             }
 
-            tree.Remove(tkey_value[idx]);
+            tree.Remove(row.GetKey(idx)); // before DeleteRecord moves the last record of the block over it
           }
+          DeleteRecord(tbl, block_num, j);
+        } else { // else the last record of the block has been moved to j
+          j++;
         }
       }
 
-      block_num = bp->GetNextBlockNum();
+      block_num = next_num;
     }
   } 
   else { // if has index
@@ -404,27 +552,21 @@ void RecordManager::Delete(SQLDelete &st) {
       blocknum = blocknum >> 16;
       blocknum = blocknum & 0xffff;
       blockoffset = blockoffset & 0xffff;
-      vector<TKey> tkey_value = GetRecord(tbl, blocknum, blockoffset);
-      bool sats = true;
-
-      for (int k = 0; k < st.wheres().size(); ++k) {
-        SQLWhere where = st.wheres()[k];
-        if (!SatisfyWhere(tbl, tkey_value, where)) {
-          sats = false;
-        }
-      }
+      BlockGuard bp(hdl_, GetBlockInfo(tbl, blocknum));
+      RowView row(&layout, bp->GetContentAddress() + blockoffset * layout.record_length());
+      bool sats = SatisfyWheres(preds, row);
       if (sats) {
         DeleteRecord(tbl, blocknum, blockoffset);
         tree.Remove(dest_key);
       }
     }
   }
-
-  hdl_->WriteToDisk();
 }
 
 void RecordManager::Update(SQLUpdate &st) {
   Table *tbl = cm_->GetDB(db_name_)->GetTable(st.tb_name());
+  RecordLayout layout(tbl);
+  vector<Predicate> preds = BindWheres(layout, tbl, st.wheres());
 
   vector<int> indices;
   vector<TKey> values;
@@ -460,13 +602,13 @@ void RecordManager::Update(SQLUpdate &st) {
       }
     } else {
       int block_num = tbl->first_block_num();
-      for (int i = 0; i < tbl->block_count(); ++i) {
-        BlockInfo *bp = GetBlockInfo(tbl, block_num);
+      for (int i = 0; i < tbl->block_count() && block_num != -1; ++i) {
+        BlockGuard bp(hdl_, GetBlockInfo(tbl, block_num));
 
         for (int j = 0; j < bp->GetRecordCount(); ++j) {
-          vector<TKey> tkey_value = GetRecord(tbl, block_num, j);
+          RowView row(&layout, bp->GetContentAddress() + j * layout.record_length());
 
-          if (tkey_value[pk_index] == values[affect_index]) {
+          if (row.Compare(pk_index, values[affect_index]) == 0) {
             throw PrimaryKeyConflictException();
           }
         }
@@ -477,20 +619,13 @@ void RecordManager::Update(SQLUpdate &st) {
   }
 
   int block_num = tbl->first_block_num();
-  for (int i = 0; i < tbl->block_count(); ++i) {
-    BlockInfo *bp = GetBlockInfo(tbl, block_num);
+  for (int i = 0; i < tbl->block_count() && block_num != -1; ++i) {
+    BlockGuard bp(hdl_, GetBlockInfo(tbl, block_num));
 
     for (int j = 0; j < bp->GetRecordCount(); ++j) {
-      vector<TKey> tkey_value = GetRecord(tbl, block_num, j);
+      RowView row(&layout, bp->GetContentAddress() + j * layout.record_length());
 
-      bool sats = true;
-
-      for (int k = 0; k < st.wheres().size(); ++k) {
-        SQLWhere where = st.wheres()[k];
-        if (!SatisfyWhere(tbl, tkey_value, where)) {
-          sats = false;
-        }
-      }
+      bool sats = SatisfyWheres(preds, row);
       if (sats) {
         if (tbl->GetIndexNum() != 0) {
           BPlusTree tree(tbl->GetIndex(0), hdl_, cm_, db_name_);
@@ -502,12 +637,10 @@ void RecordManager::Update(SQLUpdate &st) {
             }
           }
 
-          tree.Remove(tkey_value[idx]);
+          tree.Remove(row.GetKey(idx));
         }
 
-        UpdateRecord(tbl, block_num, j, indices, values);
-
-        tkey_value = GetRecord(tbl, block_num, j);
+        UpdateRecord(tbl, block_num, j, indices, values); // row sees the new values
 
         if (tbl->GetIndexNum() != 0) {
           BPlusTree tree(tbl->GetIndex(0), hdl_, cm_, db_name_);
@@ -519,15 +652,278 @@ void RecordManager::Update(SQLUpdate &st) {
             }
           }
 
-          tree.Add(tkey_value[idx], block_num, j);
+          TKey key = row.GetKey(idx);
+          tree.Add(key, block_num, j);
         }
       }
     }
 
     block_num = bp->GetNextBlockNum();
   }
+}
+
+// Splits the line of CSV at p into fields, separated by commas. A field may be quoted with ",
+// and "" inside the quotes is one ". A quoted field may span lines.
+// Returns the start of the next line, or NULL if the line does not end before end and the file goes on
+static const char *ParseCSVLine(const char *p, const char *end, bool at_eof,
+                                vector<string> &fields) {
+  const char *start = p;
+  fields.assign(1, string());
+  bool quoted = false;
+  while (p < end) {
+    char c = *p++;
+    if (quoted) {
+      if (c != '"') {
+        fields.back() += c;
+      } else if (p < end && *p == '"') {
+        fields.back() += '"';
+        p++;
+      } else if (p == end && !at_eof) { // "" may go on in the next chunk
+        return NULL;
+      } else {
+        quoted = false;
+      }
+    } else if (c == '"') {
+      quoted = true;
+    } else if (c == ',') {
+      fields.push_back(string());
+    } else if (c == '\n') {
+      break;
+    } else {
+      fields.back() += c;
+    }
+  }
+  if (p == end && !at_eof && (p == start || quoted || p[-1] != '\n')) {
+    return NULL;
+  }
+  string &last = fields.back();
+  if (!last.empty() && last[last.length() - 1] == '\r') {
+    last.erase(last.length() - 1);
+  }
+  return p;
+}
+
+// Writes the fields in the record_length layout of tbl, false if a number is not a number
+static bool FillRow(Table *tbl, vector<string> &fields, char *row) {
+  for (unsigned int i = 0; i < fields.size(); ++i) {
+    Attribute &attr = tbl->ats()[i];
+    const char *value = fields[i].c_str();
+    char *rest;
+    switch (attr.data_type()) {
+    case T_INT: {
+      int a = strtol(value, &rest, 10);
+      memcpy(row, &a, 4);
+    } break;
+    case T_FLOAT: {
+      float a = strtof(value, &rest);
+      memcpy(row, &a, 4);
+    } break;
+    default: { // strings longer than the attribute are cut like in #INSERT#
+      memset(row, 0, attr.length());
+      memcpy(row, value, min((int)fields[i].length(), attr.length()));
+      rest = NULL;
+    } break;
+    }
+    if (rest != NULL) {
+      if (rest == value) {
+        return false;
+      }
+      while (*rest == ' ') {
+        rest++;
+      }
+      if (*rest != '\0') {
+        return false;
+      }
+    }
+    row += attr.length();
+  }
+  return true;
+}
+
+// The rows are written straight into new blocks appended to the records file, which are only zeroed and not read,
+// and every full block is left to be written back, so the blocks go to disk in runs of consecutive blocks.
+// The new blocks are linked at the front of the chain of used blocks, and the catalog is written once at the end.
+// The rows go into the index once their blocks are written, in the order of their keys like the rows of an INSERT.
+// A line with a wrong number of values, a value that is not a number or a primary key that is already there is skipped
+void RecordManager::Load(SQLLoad &st) {
+  Table *tbl = cm_->GetDB(db_name_)->GetTable(st.tb_name());
+  if (tbl == NULL) {
+    throw TableNotExistException();
+  }
+
+  ifstream in(st.file_name().c_str(), ios::in | ios::binary);
+  if (!in) {
+    throw FileNotExistException();
+  }
 
+  int max_count = (hdl_->page_size() - 12) / (tbl->record_length());
+  int pk_index = -1;
+  int pk_offset = 0;
+  for (int i = 0, offset = 0; i < tbl->ats().size(); ++i) {
+    if (tbl->ats()[i].attr_type() == 1) {
+      pk_index = i;
+      pk_offset = offset;
+    }
+    offset += tbl->ats()[i].length();
+  }
+
+  // the primary key is looked up in the index, or else in the keys of the table read once here,
+  // and in the keys of the rows loaded so far
+  BPlusTree *tree = NULL;
+  unordered_set<string> keys;
+  vector<TKey> index_keys; // of the loaded rows, added to the index at the end
+  vector<int> positions;
+  if (pk_index != -1 && tbl->GetIndexNum() != 0) {
+    tree = new BPlusTree(tbl->GetIndex(0), hdl_, cm_, db_name_);
+  } else if (pk_index != -1) {
+    int block_num = tbl->first_block_num();
+    for (int i = 0; i < tbl->block_count() && block_num != -1; ++i) {
+      BlockGuard bp(hdl_, GetBlockInfo(tbl, block_num));
+      char *content = bp->GetContentAddress() + pk_offset;
+      for (int j = 0; j < bp->GetRecordCount(); ++j) {
+        keys.insert(KeyOf(tbl->ats()[pk_index], content));
+        content += tbl->record_length();
+      }
+      block_num = bp->GetNextBlockNum();
+    }
+  }
+
+  int file_id = hdl_->GetFileId(db_name_, tbl->tb_name(), FORMAT_RECORD);
+  int first_new = tbl->block_count();
+  int block_num = first_new - 1; // of bp
+  BlockInfo *bp = NULL;          // the block being filled, pinned
+  int unwritten = 0;             // full blocks not written back yet
+  long loaded = 0, skipped = 0;
+  int line_num = 0;
+  vector<string> fields;
+  vector<char> row(tbl->record_length());
+  string chunk;
+  size_t pos = 0;
+
+  try {
+    bool at_eof = false;
+    while (true) {
+      const char *next = ParseCSVLine(chunk.data() + pos, chunk.data() + chunk.size(),
+                                      at_eof, fields);
+      if (next == NULL) { // keep the unfinished line and read the next chunk after it
+        chunk.erase(0, pos);
+        pos = 0;
+        size_t size = chunk.size();
+        chunk.resize(size + LOAD_CHUNK_BYTES);
+        in.read(&chunk[size], LOAD_CHUNK_BYTES);
+        chunk.resize(size + in.gcount());
+        at_eof = in.gcount() < LOAD_CHUNK_BYTES;
+        continue;
+      }
+      if (pos == chunk.size() && at_eof) {
+        break;
+      }
+      pos = next - chunk.data();
+      line_num++;
+
+      if (line_num <= st.ignore_lines() || (fields.size() == 1 && fields[0].empty())) {
+        continue;
+      }
+      if (fields.size() != tbl->ats().size()) {
+        cerr << "Line " << line_num << ": " << fields.size() << " values for "
+             << tbl->ats().size() << " attributes, skipped" << endl;
+        skipped++;
+        continue;
+      }
+      if (!FillRow(tbl, fields, &row[0])) {
+        cerr << "Line " << line_num << ": invalid value, skipped" << endl;
+        skipped++;
+        continue;
+      }
+
+      TKey key(pk_index == -1 ? T_INT : tbl->ats()[pk_index].data_type(),
+               pk_index == -1 ? 4 : tbl->ats()[pk_index].length());
+      if (pk_index != -1) {
+        memcpy(key.key(), &row[pk_offset], key.length());
+        bool conflict = (tree != NULL && tree->GetVal(key) != -1) ||
+                        !keys.insert(KeyOf(tbl->ats()[pk_index], &row[pk_offset])).second;
+        if (conflict) {
+          cerr << "Line " << line_num << ": primary key conflicts, skipped" << endl;
+          skipped++;
+          continue;
+        }
+      }
+
+      if (bp == NULL || bp->GetRecordCount() == max_count) { // start the next block of the file
+        if (tree != NULL && block_num + 1 >= INDEX_MAX_BLOCKS) { // nothing is linked or indexed yet
+          throw IndexPositionOverflowException();
+        }
+        BlockInfo *nbp = hdl_->PinNewFileBlock(file_id, block_num + 1);
+        nbp->SetPrevBlockNum(bp == NULL ? -1 : block_num);
+        nbp->SetNextBlockNum(-1);
+        nbp->SetRecordCount(0);
+        if (bp != NULL) {
+          bp->SetNextBlockNum(block_num + 1);
+          hdl_->WriteBlock(bp);
+          hdl_->UnpinBlock(bp);
+          if (++unwritten >= hdl_->pool_pages() / 4) { // before the replacers write them back one by one
+            hdl_->WriteToDisk();
+            unwritten = 0;
+          }
+        }
+        bp = nbp;
+        block_num++;
+      }
+      memcpy(bp->GetContentAddress() + bp->GetRecordCount() * tbl->record_length(),
+             &row[0], tbl->record_length());
+      bp->SetRecordCount(bp->GetRecordCount() + 1);
+      if (tree != NULL) {
+        index_keys.push_back(key);
+        positions.push_back((block_num << 16) | (bp->GetRecordCount() - 1));
+      }
+      loaded++;
+    }
+  } catch (...) {
+    if (bp != NULL) {
+      hdl_->UnpinBlock(bp);
+    }
+    delete tree;
+    throw;
+  }
+
+  if (bp != NULL) { // link the new blocks first_new <-> ... <-> block_num in front of the chain
+    int old_first = tbl->first_block_num();
+    bp->SetNextBlockNum(old_first);
+    hdl_->WriteBlock(bp);
+    if (bp->GetRecordCount() < max_count) {
+      tbl->SetBlockFree(block_num, true);
+    }
+    hdl_->UnpinBlock(bp);
+    if (old_first != -1) {
+      BlockGuard head(hdl_, GetBlockInfo(tbl, old_first));
+      head->SetPrevBlockNum(block_num);
+      hdl_->WriteBlock(head.get());
+    }
+    tbl->set_first_block_num(first_new);
+    while (tbl->block_count() <= block_num) {
+      tbl->IncreaseBlockCount();
+    }
+  }
   hdl_->WriteToDisk();
+
+  if (tree != NULL) {
+    vector<int> order(index_keys.size());
+    for (int r = 0; r < order.size(); ++r) {
+      order[r] = r;
+    }
+    sort(order.begin(), order.end(), [&](int a, int b) { return index_keys[a] < index_keys[b]; });
+    for (int r = 0; r < order.size(); ++r) {
+      int pos = positions[order[r]];
+      tree->Add(index_keys[order[r]], pos >> 16, pos & 0xFFFF);
+    }
+    delete tree;
+    hdl_->WriteToDisk();
+  }
+  cm_->WriteArchiveFile();
+
+  cout << loaded << " rows loaded into " << tbl->tb_name() << " in "
+       << block_num + 1 - first_new << " new blocks, " << skipped
+       << " lines skipped" << endl;
 }
 
 std::vector<TKey> RecordManager::GetRecord(Table *tbl, int block_num,
@@ -554,11 +950,17 @@ std::vector<TKey> RecordManager::GetRecord(Table *tbl, int block_num,
 }
 
 void RecordManager::DeleteRecord(Table *tbl, int block_num, int offset) {
-  BlockInfo *bp = GetBlockInfo(tbl, block_num);
+  BlockGuard bp(hdl_, GetBlockInfo(tbl, block_num));
 
   char *content = bp->data() + offset * tbl->record_length() + 12;
   char *replace =
       bp->data() + (bp->GetRecordCount() - 1) * tbl->record_length() + 12;
+  if (content != replace && tbl->GetIndexNum() != 0) { // the index follows the record to its new place
+    RecordLayout layout(tbl);
+    RowView row(&layout, replace);
+    BPlusTree tree(tbl->GetIndex(0), hdl_, cm_, db_name_);
+    tree.SetVal(row.GetKey(tbl->GetAttributeIndex(tbl->GetIndex(0)->attr_name())), block_num, offset);
+  }
   memcpy(content, replace, tbl->record_length());
 
   bp->DecreaseRecordCount();
@@ -569,35 +971,41 @@ void RecordManager::DeleteRecord(Table *tbl, int block_num, int offset) {
     int nextnum = bp->GetNextBlockNum();
 
     if (prevnum != -1) {
-      BlockInfo *pbp = GetBlockInfo(tbl, prevnum);
+      BlockGuard pbp(hdl_, GetBlockInfo(tbl, prevnum));
       pbp->SetNextBlockNum(nextnum);
-      hdl_->WriteBlock(pbp);
+      hdl_->WriteBlock(pbp.get());
+    } else { // it was the head of the useful linkedlist
+      tbl->set_first_block_num(nextnum);
     }
 
     if (nextnum != -1) {
-      BlockInfo *nbp = GetBlockInfo(tbl, nextnum);
+      BlockGuard nbp(hdl_, GetBlockInfo(tbl, nextnum));
       nbp->SetPrevBlockNum(prevnum);
-      hdl_->WriteBlock(nbp);
+      hdl_->WriteBlock(nbp.get());
     }
 
-    BlockInfo *firstrubbish = GetBlockInfo(tbl, tbl->first_rubbish_num());
+    BlockGuard firstrubbish(hdl_, GetBlockInfo(tbl, tbl->first_rubbish_num()));
     bp->SetNextBlockNum(-1);
     bp->SetPrevBlockNum(-1);
-    if (firstrubbish != NULL) {
+    if (firstrubbish.get() != NULL) {
       firstrubbish->SetPrevBlockNum(block_num);
       bp->SetNextBlockNum(firstrubbish->block_num());
+      hdl_->WriteBlock(firstrubbish.get());
     }
     tbl->set_first_rubbish_num(block_num);
+    tbl->SetBlockFree(block_num, false);
+  } else {
+    tbl->SetBlockFree(block_num, true);
   }
 
-  hdl_->WriteBlock(bp);
+  hdl_->WriteBlock(bp.get());
 }
 
 void RecordManager::UpdateRecord(Table *tbl, int block_num, int offset,
                                  std::vector<int> &indices,
                                  std::vector<TKey> &values) {
 
-  BlockInfo *bp = GetBlockInfo(tbl, block_num);
+  BlockGuard bp(hdl_, GetBlockInfo(tbl, block_num));
 
   char *content = bp->data() + offset * tbl->record_length() + 12;
 
@@ -611,42 +1019,246 @@ void RecordManager::UpdateRecord(Table *tbl, int block_num, int offset,
     content += tbl->ats()[i].length();
   }
 
-  hdl_->WriteBlock(bp);
+  hdl_->WriteBlock(bp.get());
+}
+
+// The attributes a select writes, all of them for *
+vector<int> RecordManager::BindColumns(Table *tbl, vector<string> &col_names) {
+  vector<int> columns;
+  if (col_names.empty()) {
+    for (int i = 0; i < tbl->GetAttributeNum(); ++i) {
+      columns.push_back(i);
+    }
+    return columns;
+  }
+  for (int k = 0; k < col_names.size(); ++k) {
+    int idx = tbl->GetAttributeIndex(col_names[k]);
+    if (idx == -1) {
+      throw AttributeNotExistException();
+    }
+    columns.push_back(idx);
+  }
+  return columns;
+}
+
+// Every where gets the attribute it reads and its literal decoded once, and the kernel for the type and sign
+vector<Predicate> RecordManager::BindWheres(RecordLayout &layout, Table *tbl,
+                                            vector<SQLWhere> &wheres) {
+  vector<Predicate> preds;
+  for (int k = 0; k < wheres.size(); ++k) {
+    int idx = tbl->GetAttributeIndex(wheres[k].key);
+    if (idx == -1) {
+      throw AttributeNotExistException();
+    }
+    preds.push_back(Predicate(layout, idx, wheres[k].sign_type, wheres[k].value));
+  }
+  return preds;
+}
+
+// The range the wheres on the key of idx restrict it to, its bounds decoded like the key
+KeyRange RecordManager::BindRange(Index *idx, vector<SQLWhere> &wheres) {
+  KeyRange range(idx->key_type(), idx->key_len());
+  for (int k = 0; k < wheres.size(); ++k) {
+    if (wheres[k].key == idx->attr_name() && wheres[k].sign_type != SIGN_EQ &&
+        wheres[k].sign_type != SIGN_NE) {
+      TKey key(idx->key_type(), idx->key_len());
+      key.ReadValue(wheres[k].value);
+      range.Restrict(wheres[k].sign_type, key);
+    }
+  }
+  return range;
+}
+
+bool RecordManager::SatisfyWheres(vector<Predicate> &preds, RowView &row) {
+  for (int k = 0; k < preds.size(); ++k) {
+    if (!preds[k].Eval(row.data())) {
+      return false;
+    }
+  }
+  return true;
 }
 
-bool RecordManager::SatisfyWhere(Table *tbl, std::vector<TKey> keys,
-                                 SQLWhere where) {
-  int idx = -1;
+RecordLayout::RecordLayout(Table *tbl) : record_length_(tbl->record_length()) {
+  int offset = 0;
   for (int i = 0; i < tbl->GetAttributeNum(); ++i) {
-    if (tbl->ats()[i].attr_name() == where.key) {
-      idx = i;
+    offsets_.push_back(offset);
+    data_types_.push_back(tbl->ats()[i].data_type());
+    lengths_.push_back(tbl->ats()[i].length());
+    offset += tbl->ats()[i].length();
+  }
+}
+
+int RowView::Compare(int i, TKey &key) {
+  switch (layout_->data_type(i)) {
+  case T_INT: {
+    int a = GetInt(i);
+    int b = *(int *)key.key();
+    return a < b ? -1 : (a > b ? 1 : 0);
+  }
+  case T_FLOAT: {
+    float a = GetFloat(i);
+    float b = *(float *)key.key();
+    return a < b ? -1 : (a > b ? 1 : 0);
+  }
+  default:
+    return strncmp(Get(i), key.key(), layout_->length(i));
+  }
+}
+
+TKey RowView::GetKey(int i) {
+  TKey key(layout_->data_type(i), layout_->length(i));
+  memcpy(key.key(), Get(i), key.length());
+  return key;
+}
+
+// The digits of value into text, returns how many characters
+static int FormatInt(int value, char *text) {
+  char digits[16];
+  int count = 0;
+  unsigned int u = value < 0 ? 0u - (unsigned int)value : value;
+  do {
+    digits[count++] = '0' + u % 10;
+    u /= 10;
+  } while (u != 0);
+  int length = 0;
+  if (value < 0) {
+    text[length++] = '-';
+  }
+  while (count > 0) {
+    text[length++] = digits[--count];
+  }
+  return length;
+}
+
+void ResultWriter::Format(RowView &row, string &text) {
+  RecordLayout *layout = row.layout();
+  char number[32];
+  for (int k = 0; k < columns_.size(); ++k) {
+    int i = columns_[k];
+    const char *value = number;
+    int length;
+    switch (layout->data_type(i)) {
+    case T_INT:
+      length = FormatInt(row.GetInt(i), number);
+      break;
+    case T_FLOAT: // %g is how ostream prints a float by default
+      length = snprintf(number, sizeof(number), "%g", row.GetFloat(i));
+      break;
+    default: // a string fills its attribute without a terminating zero byte
+      value = row.Get(i);
+      length = strnlen(value, layout->length(i));
+      break;
+    }
+    text.append(value, length);
+    if (length < 9) {
+      text.append(9 - length, ' ');
     }
   }
-  // cout << idx;
+  text += '\n';
+}
 
-  TKey tmp(tbl->ats()[idx].data_type(), tbl->ats()[idx].length());
-  tmp.ReadValue(where.value.c_str());
-  switch (where.sign_type) {
-  case SIGN_EQ:
-    return keys[idx] == tmp;
-    break;
-  case SIGN_NE:
-    return keys[idx] != tmp;
-    break;
-  case SIGN_LT:
-    return keys[idx] < tmp;
-    break;
-  case SIGN_GT:
-    return keys[idx] > tmp;
-    break;
-  case SIGN_LE:
-    return keys[idx] <= tmp;
+Predicate::Predicate(RecordLayout &layout, int attr, int sign_type,
+                     const std::string &value)
+    : data_type_(layout.data_type(attr)), sign_type_(sign_type),
+      offset_(layout.offset(attr)), length_(layout.length(attr)), int_value_(0),
+      float_value_(0) {
+  if (sign_type < SIGN_EQ || sign_type > SIGN_GE) { // it indexes the kernel tables
+    throw SyntaxErrorException();
+  }
+  switch (layout.data_type(attr)) {
+  case T_INT:
+    int_value_ = atoi(value.c_str());
+    kernel_ = NumberKernel<int>(sign_type);
     break;
-  case SIGN_GE:
-    return keys[idx] >= tmp;
+  case T_FLOAT:
+    float_value_ = atof(value.c_str());
+    kernel_ = NumberKernel<float>(sign_type);
     break;
   default:
-    return false;
+    chars_.assign(length_, 0);
+    memcpy(&chars_[0], value.c_str(), min((int)value.length(), length_));
+    switch (sign_type) {
+    case SIGN_EQ: kernel_ = CompareChars<SIGN_EQ>; break;
+    case SIGN_NE: kernel_ = CompareChars<SIGN_NE>; break;
+    case SIGN_LT: kernel_ = CompareChars<SIGN_LT>; break;
+    case SIGN_GT: kernel_ = CompareChars<SIGN_GT>; break;
+    case SIGN_LE: kernel_ = CompareChars<SIGN_LE>; break;
+    default: kernel_ = CompareChars<SIGN_GE>; break;
+    }
     break;
   }
 }
+
+template <class T> Predicate::Kernel Predicate::NumberKernel(int sign_type) {
+  switch (sign_type) {
+  case SIGN_EQ: return CompareNumber<T, SIGN_EQ>;
+  case SIGN_NE: return CompareNumber<T, SIGN_NE>;
+  case SIGN_LT: return CompareNumber<T, SIGN_LT>;
+  case SIGN_GT: return CompareNumber<T, SIGN_GT>;
+  case SIGN_LE: return CompareNumber<T, SIGN_LE>;
+  default: return CompareNumber<T, SIGN_GE>;
+  }
+}
+
+// SIGN is known when the kernel is compiled, so every kernel is one comparison
+template <int SIGN, class T> bool Predicate::Apply(T a, T b) {
+  switch (SIGN) {
+  case SIGN_EQ: return a == b;
+  case SIGN_NE: return a != b;
+  case SIGN_LT: return a < b;
+  case SIGN_GT: return a > b;
+  case SIGN_LE: return !(a > b); // like operator<= of TKey
+  default: return !(a < b);
+  }
+}
+
+template <class T, int SIGN>
+bool Predicate::CompareNumber(Predicate &pred, const char *record) {
+  T a, b;
+  memcpy(&a, record + pred.offset_, sizeof(T));
+  pred.literal(b);
+  return Apply<SIGN>(a, b);
+}
+
+template <int SIGN> bool Predicate::CompareChars(Predicate &pred, const char *record) {
+  return Apply<SIGN>(strncmp(record + pred.offset_, &pred.chars_[0], pred.length_), 0);
+}
+
+void BlockFilter::Run(const char *records, int count, int record_length) {
+  int words = (count + 63) / 64;
+  sel_.assign(words, ~0ULL);
+  if (count % 64 != 0) {
+    sel_[words - 1] = (1ULL << (count % 64)) - 1;
+  }
+  if (count == 0) {
+    return;
+  }
+
+  for (int k = 0; k < preds_.size(); ++k) {
+    Predicate &pred = preds_[k];
+    const char *value = records + pred.offset();
+    if (pred.data_type() == T_INT) {
+      ints_.resize(count);
+      for (int j = 0; j < count; ++j, value += record_length) {
+        memcpy(&ints_[j], value, 4);
+      }
+      FilterInts(&ints_[0], count, pred.sign_type(), pred.int_value(), &sel_[0]);
+    } else if (pred.data_type() == T_FLOAT) {
+      floats_.resize(count);
+      for (int j = 0; j < count; ++j, value += record_length) {
+        memcpy(&floats_[j], value, 4);
+      }
+      FilterFloats(&floats_[0], count, pred.sign_type(), pred.float_value(), &sel_[0]);
+    }
+  }
+
+  for (int k = 0; k < preds_.size(); ++k) {
+    if (preds_[k].data_type() == T_CHAR) {
+      for (int j = 0; j < count; ++j) {
+        if (selected(j) && !preds_[k].Eval(records + j * record_length)) {
+          sel_[j >> 6] &= ~(1ULL << (j & 63));
+        }
+      }
+    }
+  }
+}
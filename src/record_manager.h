@@ -1,6 +1,7 @@
 #ifndef MINIDB_RECORD_MANAGER_H_
 #define MINIDB_RECORD_MANAGER_H_
 
+#include <ostream>
 #include <string>
 #include <vector>
 
@@ -8,30 +9,185 @@
 #include "buffer_manager.h"
 #include "catalog_manager.h"
 #include "exceptions.h"
+#include "index_manager.h"
 #include "sql_statement.h"
 
+// LOAD DATA reads the file in chunks of this many bytes
+#define LOAD_CHUNK_BYTES (1 << 20)
+// The index stores a record as (block_num << 16) | offset in an int, so it can only reach blocks below this
+#define INDEX_MAX_BLOCKS (1 << 15)
+// Full scans of tables with fewer blocks are not split between threads
+#define PARALLEL_SCAN_MIN_BLOCKS 64
+// A thread of a parallel scan takes this many neighbouring blocks at a time, which go to the same shard of the buffer
+#define SCAN_CHUNK_BLOCKS SHARD_EXTENT_PAGES
+// SELECT writes its result out in pieces of about this many bytes
+#define RESULT_BUFFER_BYTES (64 << 10)
+
+// Where every attribute of a record of a table starts, worked out once per statement
+class RecordLayout {
+private:
+  std::vector<int> offsets_;
+  std::vector<int> data_types_;
+  std::vector<int> lengths_;
+  int record_length_;
+
+public:
+  RecordLayout(Table *tbl);
+  int attr_num() { return offsets_.size(); }
+  int offset(int i) { return offsets_[i]; }
+  int data_type(int i) { return data_types_[i]; }
+  int length(int i) { return lengths_[i]; }
+  int record_length() { return record_length_; }
+};
+
+// A record where it lies in its block, only valid while the block is pinned.
+// Reading an attribute copies nothing, so scanning a table allocates nothing per record
+class RowView {
+private:
+  RecordLayout *layout_;
+  const char *data_;
+
+public:
+  RowView(RecordLayout *layout, const char *data) : layout_(layout), data_(data) {}
+  RecordLayout *layout() { return layout_; }
+  const char *data() { return data_; }
+  const char *Get(int i) { return data_ + layout_->offset(i); }
+  int GetInt(int i) {
+    int a;
+    memcpy(&a, Get(i), 4);
+    return a;
+  }
+  float GetFloat(int i) {
+    float a;
+    memcpy(&a, Get(i), 4);
+    return a;
+  }
+  int Compare(int i, TKey &key); // <0, 0 or >0 like the comparisons of TKey
+  TKey GetKey(int i);            // a copy of attribute i, e.g. for the index
+};
+
+// Select writes every record that qualifies through this as soon as it finds it, and the text goes out
+// once RESULT_BUFFER_BYTES of it have piled up, so neither the memory nor the time to the first record
+// grow with the size of the result. Only the selected attributes of a record are ever read
+class ResultWriter {
+private:
+  std::ostream &out_;
+  std::string buffer_;
+  std::vector<int> columns_; // the attributes to write, in the order of the select
+
+public:
+  ResultWriter(std::ostream &out, const std::vector<int> &columns) : out_(out), columns_(columns) {
+    buffer_.reserve(RESULT_BUFFER_BYTES);
+  }
+  ~ResultWriter() { Flush(); }
+  // One line, every selected attribute left aligned in 9 columns like operator<< of TKey after setw(9).
+  // Only reads columns_, so the threads of a parallel scan format their records through the same writer
+  void Format(RowView &row, std::string &text);
+  void Write(RowView &row) {
+    Format(row, buffer_);
+    if (buffer_.size() >= RESULT_BUFFER_BYTES) {
+      Flush();
+    }
+  }
+  void Write(const std::string &text) {
+    buffer_ += text;
+    if (buffer_.size() >= RESULT_BUFFER_BYTES) {
+      Flush();
+    }
+  }
+  void Flush() {
+    out_.write(buffer_.data(), buffer_.size());
+    out_.flush();
+    buffer_.clear();
+  }
+};
+
+// A where of a statement bound to a table: the offset of the attribute it reads, its literal decoded once
+// and a comparison kernel specialized for the type of the attribute and the sign, picked once
+class Predicate {
+private:
+  typedef bool (*Kernel)(Predicate &pred, const char *record);
+
+  Kernel kernel_;
+  int data_type_;
+  int sign_type_;
+  int offset_;
+  int length_;
+  int int_value_;
+  float float_value_;
+  std::vector<char> chars_; // zero padded to length_
+
+  template <class T> static Kernel NumberKernel(int sign_type);
+  template <class T, int SIGN> static bool CompareNumber(Predicate &pred, const char *record);
+  template <int SIGN> static bool CompareChars(Predicate &pred, const char *record);
+  template <int SIGN, class T> static bool Apply(T a, T b);
+  void literal(int &value) { value = int_value_; }
+  void literal(float &value) { value = float_value_; }
+
+public:
+  Predicate(RecordLayout &layout, int attr, int sign_type, const std::string &value);
+  bool Eval(const char *record) { return kernel_(*this, record); }
+  int data_type() { return data_type_; }
+  int sign_type() { return sign_type_; }
+  int offset() { return offset_; }
+  int int_value() { return int_value_; }
+  float float_value() { return float_value_; }
+};
+
+// The wheres of a statement evaluated on all records of a block at once.
+// The INT and FLOAT attributes they read are copied out of the records into a column each,
+// which the SIMD kernels of filter_kernels.h compare in one go, and the wheres on strings
+// are then evaluated record by record on the records that are still selected
+class BlockFilter {
+private:
+  std::vector<Predicate> &preds_;
+  std::vector<int> ints_;
+  std::vector<float> floats_;
+  std::vector<unsigned long long> sel_; // bit j % 64 of sel_[j / 64] is set if record j satisfies every where
+
+public:
+  BlockFilter(std::vector<Predicate> &preds) : preds_(preds) {}
+  void Run(const char *records, int count, int record_length);
+  bool selected(int j) { return (sel_[j >> 6] >> (j & 63)) & 1; }
+};
+
 class RecordManager {
 private:
   BufferManager *hdl_;
   CatalogManager *cm_;
   std::string db_name_;
+  Table *file_tbl_; // the table whose records file id is cached in file_id_
+  int file_id_;
+  static int scan_threads_; // of a full scan, 0 is one per core
+
+  void ParallelScan(Table *tbl, RecordLayout &layout, std::vector<Predicate> &preds,
+                    int threads, ResultWriter &writer);
 
 public:
   RecordManager(CatalogManager *cm, BufferManager *hdl, std::string db)
-      : cm_(cm), hdl_(hdl), db_name_(db) {}
+      : cm_(cm), hdl_(hdl), db_name_(db), file_tbl_(NULL), file_id_(-1) {}
   ~RecordManager() {}
+  static int scan_threads() { return scan_threads_; }
+  static void set_scan_threads(int threads) { scan_threads_ = threads; }
   void Insert(SQLInsert &st);
   void Select(SQLSelect &st);
   void Delete(SQLDelete &st);
   void Update(SQLUpdate &st);
+  void Load(SQLLoad &st);
 
   BlockInfo *GetBlockInfo(Table *tbl, int block_num);
+  BlockInfo *PinInsertBlock(Table *tbl, int &block_num);
+  void BuildFreeMap(Table *tbl, int max_count);
   std::vector<TKey> GetRecord(Table *tbl, int block_num, int offset);
   void DeleteRecord(Table *tbl, int block_num, int offset);
   void UpdateRecord(Table *tbl, int block_num, int offset,
                     std::vector<int> &indices, std::vector<TKey> &values);
 
-  bool SatisfyWhere(Table *tbl, std::vector<TKey> keys, SQLWhere where);
+  std::vector<int> BindColumns(Table *tbl, std::vector<std::string> &col_names);
+  std::vector<Predicate> BindWheres(RecordLayout &layout, Table *tbl,
+                                    std::vector<SQLWhere> &wheres);
+  KeyRange BindRange(Index *idx, std::vector<SQLWhere> &wheres);
+  bool SatisfyWheres(std::vector<Predicate> &preds, RowView &row);
 };
 
 #endif /* MINIDB_RECORD_MANAGER_H_ */
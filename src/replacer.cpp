@@ -0,0 +1,197 @@
+#include "replacer.h"
+
+#include "commons.h"
+#include "file_handle.h"
+
+using namespace std;
+
+Replacer *Replacer::Create(int policy) {
+  if (policy == REPLACER_CLOCK) {
+    return new ClockReplacer();
+  }
+  if (policy == REPLACER_2Q) {
+    return new TwoQReplacer();
+  }
+  return new LRUReplacer();
+}
+
+//=======================BlockList=======================//
+
+void BlockList::Unlink(BlockInfo *block) {
+  if (block->lru_prev() != NULL) {
+    block->lru_prev()->set_lru_next(block->lru_next());
+  } else {
+    head_ = block->lru_next();
+  }
+  if (block->lru_next() != NULL) {
+    block->lru_next()->set_lru_prev(block->lru_prev());
+  } else {
+    tail_ = block->lru_prev();
+  }
+  block->set_lru_prev(NULL);
+  block->set_lru_next(NULL);
+  size_--;
+}
+
+void BlockList::PushFront(BlockInfo *block) {
+  block->set_lru_prev(NULL);
+  block->set_lru_next(head_);
+  if (head_ != NULL) {
+    head_->set_lru_prev(block);
+  } else {
+    tail_ = block;
+  }
+  head_ = block;
+  size_++;
+}
+
+BlockInfo *BlockList::LastUnpinned() {
+  BlockInfo *block = tail_;
+  while (block != NULL && block->pinned()) {
+    block = block->lru_prev();
+  }
+  return block;
+}
+
+//=======================LRUReplacer=======================//
+
+void LRUReplacer::Insert(BlockInfo *block) { list_.PushFront(block); }
+
+void LRUReplacer::Access(BlockInfo *block) {
+  if (block == list_.head()) {
+    return;
+  }
+  list_.Unlink(block);
+  list_.PushFront(block);
+}
+
+void LRUReplacer::Remove(BlockInfo *block) { list_.Unlink(block); }
+
+BlockInfo *LRUReplacer::Victim() {
+  BlockInfo *victim = list_.LastUnpinned();
+  if (victim != NULL) {
+    list_.Unlink(victim);
+  }
+  return victim;
+}
+
+//=======================ClockReplacer=======================//
+
+void ClockReplacer::Insert(BlockInfo *block) {
+  int slot;
+  if (!free_slots_.empty()) {
+    slot = free_slots_.back();
+    free_slots_.pop_back();
+    frames_[slot] = block;
+  } else {
+    slot = frames_.size();
+    frames_.push_back(block);
+  }
+  block->set_clock_slot(slot);
+  block->set_referenced(true);
+  count_++;
+}
+
+void ClockReplacer::Access(BlockInfo *block) { block->set_referenced(true); }
+
+void ClockReplacer::Remove(BlockInfo *block) {
+  frames_[block->clock_slot()] = NULL;
+  free_slots_.push_back(block->clock_slot());
+  block->set_clock_slot(-1);
+  count_--;
+}
+
+BlockInfo *ClockReplacer::Victim() {
+  if (count_ == 0) {
+    return NULL;
+  }
+  // at most two turns: the first one may only clear referenced bits
+  for (size_t step = 0; step <= 2 * frames_.size(); ++step) {
+    if (hand_ >= frames_.size()) {
+      hand_ = 0;
+    }
+    BlockInfo *block = frames_[hand_];
+    if (block != NULL && !block->pinned()) {
+      if (block->referenced()) {
+        block->set_referenced(false);
+      } else {
+        frames_[hand_] = NULL;
+        free_slots_.push_back((int)hand_);
+        block->set_clock_slot(-1);
+        count_--;
+        hand_++;
+        return block;
+      }
+    }
+    hand_++;
+  }
+  return NULL;
+}
+
+//=======================TwoQReplacer=======================//
+
+void TwoQReplacer::Insert(BlockInfo *block) {
+  long long page = FileHandle::PageKey(block->file()->file_id(), block->block_num());
+  unordered_map<long long, list<long long>::iterator>::iterator iter =
+      a1out_index_.find(page);
+  if (iter != a1out_index_.end()) { // read again soon after it was recycled
+    a1out_.erase(iter->second);
+    a1out_index_.erase(iter);
+    block->set_hot(true);
+    am_.PushFront(block);
+  } else {
+    block->set_hot(false);
+    a1in_.PushFront(block);
+  }
+}
+
+void TwoQReplacer::Access(BlockInfo *block) {
+  if (block->hot() && block != am_.head()) {
+    am_.Unlink(block);
+    am_.PushFront(block);
+  }
+}
+
+void TwoQReplacer::Remove(BlockInfo *block) {
+  if (block->hot()) {
+    am_.Unlink(block);
+  } else {
+    a1in_.Unlink(block);
+  }
+}
+
+void TwoQReplacer::Remember(BlockInfo *block) {
+  long long page = FileHandle::PageKey(block->file()->file_id(), block->block_num());
+  a1out_.push_front(page);
+  a1out_index_[page] = a1out_.begin();
+  unsigned int limit = (a1in_.size() + am_.size()) / 2 + 1;
+  while (a1out_.size() > limit) {
+    a1out_index_.erase(a1out_.back());
+    a1out_.pop_back();
+  }
+}
+
+// Recycle from a1in_ while it holds more than its quarter, else from am_
+BlockInfo *TwoQReplacer::Victim() {
+  BlockInfo *victim = NULL;
+  if (a1in_.size() > (a1in_.size() + am_.size()) / 4) {
+    victim = a1in_.LastUnpinned();
+  }
+  if (victim == NULL) {
+    victim = am_.LastUnpinned();
+  }
+  if (victim == NULL) {
+    victim = a1in_.LastUnpinned();
+  }
+  if (victim == NULL) {
+    return NULL;
+  }
+
+  if (victim->hot()) {
+    am_.Unlink(victim);
+  } else {
+    a1in_.Unlink(victim);
+    Remember(victim);
+  }
+  return victim;
+}
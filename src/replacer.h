@@ -0,0 +1,95 @@
+#ifndef MINIDB_REPLACER_H_
+#define MINIDB_REPLACER_H_
+
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "block_info.h"
+
+// The replacer decides which block file_handle recycles once block_handle has no empty blocks left.
+// Every block in the page table of file_handle is tracked by the replacer:
+// Insert when the block is loaded, Access on every buffer hit, Victim to choose and untrack the block to recycle,
+// Remove to untrack a block which is thrown away without being recycled.
+// All three are O(1) (amortized for CLOCK), no matter how many blocks are cached.
+// Pinned blocks are skipped by Victim, so only the pinned blocks are walked over on top of that.
+class Replacer {
+public:
+  virtual ~Replacer() {}
+  virtual void Insert(BlockInfo *block) = 0;
+  virtual void Access(BlockInfo *block) = 0;
+  virtual void Remove(BlockInfo *block) = 0;
+  virtual BlockInfo *Victim() = 0; // NULL if every tracked block is pinned
+
+  static Replacer *Create(int policy); // REPLACER_LRU, REPLACER_CLOCK or REPLACER_2Q
+};
+
+// Intrusive doubly linked list through BlockInfo::lru_prev()/lru_next()
+// head_ is the block put in last, tail_ the one put in first
+class BlockList {
+private:
+  BlockInfo *head_;
+  BlockInfo *tail_;
+  int size_;
+
+public:
+  BlockList() : head_(NULL), tail_(NULL), size_(0) {}
+
+  BlockInfo *head() { return head_; }
+  int size() { return size_; }
+  void PushFront(BlockInfo *block);
+  void Unlink(BlockInfo *block);
+  BlockInfo *LastUnpinned(); // walks from tail_, NULL if every block is pinned
+};
+
+// head of list_ is the most recently used block, its tail the least recently used one
+class LRUReplacer : public Replacer {
+private:
+  BlockList list_;
+
+public:
+  void Insert(BlockInfo *block);
+  void Access(BlockInfo *block);
+  void Remove(BlockInfo *block);
+  BlockInfo *Victim();
+};
+
+// Second chance sweep over an array of frames
+// A hit only sets the referenced bit, the hand clears it on its way and recycles the first unreferenced block
+class ClockReplacer : public Replacer {
+private:
+  std::vector<BlockInfo *> frames_;
+  std::vector<int> free_slots_;
+  size_t hand_; // slot in frames_ the sweep goes on from
+  int count_;
+
+public:
+  ClockReplacer() : hand_(0), count_(0) {}
+  void Insert(BlockInfo *block);
+  void Access(BlockInfo *block);
+  void Remove(BlockInfo *block);
+  BlockInfo *Victim();
+};
+
+// 2Q: a block read for the first time goes to the FIFO a1in_, and hits there do not move it,
+// so a table scan only ever cycles through a1in_. A block recycled from a1in_ leaves its page key in the ghost list a1out_;
+// if it is read again while remembered there, it is hot and goes to the LRU list am_.
+// a1in_ gets a quarter of the blocks and a1out_ remembers half as many keys as there are blocks,
+// so hot B+ tree nodes in am_ survive a full scan of a table of any size.
+class TwoQReplacer : public Replacer {
+private:
+  BlockList a1in_;
+  BlockList am_;
+  std::list<long long> a1out_; // page keys, the newest at the front
+  std::unordered_map<long long, std::list<long long>::iterator> a1out_index_;
+
+  void Remember(BlockInfo *block);
+
+public:
+  void Insert(BlockInfo *block);
+  void Access(BlockInfo *block);
+  void Remove(BlockInfo *block);
+  BlockInfo *Victim();
+};
+
+#endif /* MINIDB_REPLACER_H_ */
@@ -39,12 +39,26 @@ void SQLSelect::Parse(std::vector<std::string> sql_vector) {
     throw SyntaxErrorException();
   }
 
-  if (sql_vector[pos] != "*") {
-    throw SyntaxErrorException();
+  if (sql_vector[pos] == "*") {
+    pos++;
+  } else {
+    while (true) {
+      if (sql_vector.size() <= pos + 1 || sql_vector[pos] == "," || sql_vector[pos] == "from") {
+        throw SyntaxErrorException();
+      }
+      col_names_.push_back(sql_vector[pos]);
+      std::cout << "COLUMN NAME: " << sql_vector[pos] << std::endl;
+      pos++;
+
+      if (sql_vector[pos] == ",") {
+        pos++;
+      } else {
+        break;
+      }
+    }
   }
-  pos++;
 
-  if (sql_vector[pos] != "from") {
+  if (sql_vector.size() <= pos + 1 || sql_vector[pos] != "from") {
     throw SyntaxErrorException();
   }
   pos++;
@@ -63,35 +77,41 @@ void SQLSelect::Parse(std::vector<std::string> sql_vector) {
   pos++;
 
   while (true) {
-    SQLWhere where;
+    SQLWhere where = SQLWhere();
 
     where.key = sql_vector[pos];
     pos++;
 
-    if (sql_vector[pos] == "=") {
-      where.sign_type = SIGN_EQ;
-    } else if (sql_vector[pos] == "<") {
-      where.sign_type = SIGN_LT;
-    } else if (sql_vector[pos] == ">") {
-      where.sign_type = SIGN_GT;
-    } else if (sql_vector[pos] == "<=") {
-      where.sign_type = SIGN_LE;
-    } else if (sql_vector[pos] == ">=") {
-      where.sign_type = SIGN_GE;
-    } else if (sql_vector[pos] == "<>") {
-      where.sign_type = SIGN_NE;
-    }
-    pos++;
+    if (sql_vector[pos] == "between") {
+      pos = ParseBetween(sql_vector, wheres_, where.key, pos + 1);
+    } else {
+      if (sql_vector[pos] == "=") {
+        where.sign_type = SIGN_EQ;
+      } else if (sql_vector[pos] == "<") {
+        where.sign_type = SIGN_LT;
+      } else if (sql_vector[pos] == ">") {
+        where.sign_type = SIGN_GT;
+      } else if (sql_vector[pos] == "<=") {
+        where.sign_type = SIGN_LE;
+      } else if (sql_vector[pos] == ">=") {
+        where.sign_type = SIGN_GE;
+      } else if (sql_vector[pos] == "<>") {
+        where.sign_type = SIGN_NE;
+      } else {
+        throw SyntaxErrorException();
+      }
+      pos++;
 
-    where.value = sql_vector[pos];
-    pos++;
+      where.value = sql_vector[pos];
+      pos++;
 
-    if (where.value.at(0) == '\'' || where.value.at(0) == '\"') {
-      where.value.assign(where.value, 1, where.value.length() - 2);
-    }
+      if (where.value.at(0) == '\'' || where.value.at(0) == '\"') {
+        where.value.assign(where.value, 1, where.value.length() - 2);
+      }
 
-    wheres_.push_back(where);
-    cout << where.key << " " << where.sign_type << " " << where.value << endl;
+      wheres_.push_back(where);
+      cout << where.key << " " << where.sign_type << " " << where.value << endl;
+    }
 
     if (sql_vector.size() == pos) {
       break;
@@ -114,14 +134,26 @@ void SQLExec::Parse(std::vector<std::string> sql_vector) {
   }
 }
 
+// create database db_name [page_size = N]
 void SQLCreateDatabase::Parse(std::vector<std::string> sql_vector) {
   sql_type_ = 30;
+  page_size_ = PAGE_SIZE_DEFAULT;
   if (sql_vector.size() <= 2) {
     throw SyntaxErrorException();
   } else {
     std::cout << "DB NAME: " << sql_vector[2] << std::endl;
     db_name_ = sql_vector[2];
   }
+
+  if (sql_vector.size() == 3) {
+    return;
+  }
+  if (sql_vector.size() != 6 || to_lower_copy(sql_vector[3]) != "page_size" ||
+      sql_vector[4] != "=") {
+    throw SyntaxErrorException();
+  }
+  page_size_ = atoi(sql_vector[5].c_str());
+  std::cout << "PAGE SIZE: " << page_size_ << std::endl;
 }
 
 void SQLDropDatabase::Parse(std::vector<std::string> sql_vector) {
@@ -265,10 +297,11 @@ void SQLCreateIndex::Parse(std::vector<std::string> sql_vector) {
   pos++;
 }
 
+// insert into tb_name values (v1, v2, ...) [, (v1, v2, ...) ...]
 void SQLInsert::Parse(std::vector<std::string> sql_vector) {
   sql_type_ = 70;
   unsigned int pos = 1;
-  bool is_attr = true;
+  bool is_row = true;
 
   if (to_lower_copy(sql_vector[pos]) != "into") {
     throw SyntaxErrorException();
@@ -281,35 +314,47 @@ void SQLInsert::Parse(std::vector<std::string> sql_vector) {
     throw SyntaxErrorException();
   }
   pos++;
-  if (to_lower_copy(sql_vector[pos]) != "(") {
-    throw SyntaxErrorException();
-  }
-  pos++;
-  while (is_attr) {
-    is_attr = false;
-    SQLValue sql_value;
-    std::string value = sql_vector[pos];
-    // if it is a string datatype
-    if (value.at(0) == '\'' || value.at(0) == '\"') { // '\'' means single quotation, '\"' means double quotation
-      value.assign(value, 1, value.length() - 2);
-      sql_value.data_type = 2; // then sql_value.data_type = 2 means it is a string
-    } else {
-      // if it is a float datatype
-      if (value.find(".") != string::npos) { // if '.' in value:
-        sql_value.data_type = 1; // then sql_value.data_type = 1 means it is a float
+  while (is_row) {
+    is_row = false;
+    if (pos >= sql_vector.size() || sql_vector[pos] != "(") {
+      throw SyntaxErrorException();
+    }
+    pos++;
+    rows_.push_back(std::vector<SQLValue>());
+    bool is_attr = true;
+    while (is_attr) {
+      is_attr = false;
+      if (pos + 1 >= sql_vector.size()) {
+        throw SyntaxErrorException();
+      }
+      SQLValue sql_value;
+      std::string value = sql_vector[pos];
+      // if it is a string datatype
+      if (value.at(0) == '\'' || value.at(0) == '\"') { // '\'' means single quotation, '\"' means double quotation
+        value.assign(value, 1, value.length() - 2);
+        sql_value.data_type = 2; // then sql_value.data_type = 2 means it is a string
       } else {
-        // else it is an integer datatype
-        sql_value.data_type = 0; // then sql_value.data_type = 0 means it is an int
+        // if it is a float datatype
+        if (value.find(".") != string::npos) { // if '.' in value:
+          sql_value.data_type = 1; // then sql_value.data_type = 1 means it is a float
+        } else {
+          // else it is an integer datatype
+          sql_value.data_type = 0; // then sql_value.data_type = 0 means it is an int
+        }
       }
+      sql_value.value = value;
+      cout << sql_value.data_type << " : " << value << endl;
+      pos++;
+      rows_.back().push_back(sql_value);
+      if (sql_vector[pos] != ")") {
+        is_attr = true;
+      }
+      pos++;
     }
-    sql_value.value = value;
-    cout << sql_value.data_type << " : " << value << endl;
-    pos++;
-    values_.push_back(sql_value);
-    if (sql_vector[pos] != ")") {
-      is_attr = true;
+    if (pos < sql_vector.size() && sql_vector[pos] == ",") { // another row follows
+      is_row = true;
+      pos++;
     }
-    pos++;
   }
 }
 
@@ -356,6 +401,26 @@ int SQL::ParseDataType(std::vector<std::string> sql_vector, Attribute &attr,
   return pos;
 }
 
+// key BETWEEN a AND b, from pos on the first value, adds the wheres key >= a and key <= b
+int SQL::ParseBetween(std::vector<std::string> &sql_vector, std::vector<SQLWhere> &wheres,
+                      std::string key, unsigned int pos) {
+  if (sql_vector.size() <= pos + 2 || sql_vector[pos + 1] != "and") {
+    throw SyntaxErrorException();
+  }
+  for (int i = 0; i < 2; ++i) {
+    SQLWhere where = SQLWhere();
+    where.key = key;
+    where.sign_type = i == 0 ? SIGN_GE : SIGN_LE;
+    where.value = sql_vector[pos + 2 * i];
+    if (where.value.at(0) == '\'' || where.value.at(0) == '\"') {
+      where.value.assign(where.value, 1, where.value.length() - 2);
+    }
+    wheres.push_back(where);
+    cout << where.key << " " << where.sign_type << " " << where.value << endl;
+  }
+  return pos + 3;
+}
+
 void SQLDelete::Parse(std::vector<std::string> sql_vector) {
   sql_type_ = 100;
   unsigned int pos = 1;
@@ -383,35 +448,41 @@ void SQLDelete::Parse(std::vector<std::string> sql_vector) {
   pos++;
 
   while (true) {
-    SQLWhere where;
+    SQLWhere where = SQLWhere();
 
     where.key = sql_vector[pos];
     pos++;
 
-    if (sql_vector[pos] == "=") {
-      where.sign_type = SIGN_EQ;
-    } else if (sql_vector[pos] == "<") {
-      where.sign_type = SIGN_LT;
-    } else if (sql_vector[pos] == ">") {
-      where.sign_type = SIGN_GT;
-    } else if (sql_vector[pos] == "<=") {
-      where.sign_type = SIGN_LE;
-    } else if (sql_vector[pos] == ">=") {
-      where.sign_type = SIGN_GE;
-    } else if (sql_vector[pos] == "<>") {
-      where.sign_type = SIGN_NE;
-    }
-    pos++;
+    if (sql_vector[pos] == "between") {
+      pos = ParseBetween(sql_vector, wheres_, where.key, pos + 1);
+    } else {
+      if (sql_vector[pos] == "=") {
+        where.sign_type = SIGN_EQ;
+      } else if (sql_vector[pos] == "<") {
+        where.sign_type = SIGN_LT;
+      } else if (sql_vector[pos] == ">") {
+        where.sign_type = SIGN_GT;
+      } else if (sql_vector[pos] == "<=") {
+        where.sign_type = SIGN_LE;
+      } else if (sql_vector[pos] == ">=") {
+        where.sign_type = SIGN_GE;
+      } else if (sql_vector[pos] == "<>") {
+        where.sign_type = SIGN_NE;
+      } else {
+        throw SyntaxErrorException();
+      }
+      pos++;
 
-    where.value = sql_vector[pos];
-    pos++;
+      where.value = sql_vector[pos];
+      pos++;
 
-    if (where.value.at(0) == '\'' || where.value.at(0) == '\"') {
-      where.value.assign(where.value, 1, where.value.length() - 2);
-    }
+      if (where.value.at(0) == '\'' || where.value.at(0) == '\"') {
+        where.value.assign(where.value, 1, where.value.length() - 2);
+      }
 
-    wheres_.push_back(where);
-    cout << where.key << " " << where.sign_type << " " << where.value << endl;
+      wheres_.push_back(where);
+      cout << where.key << " " << where.sign_type << " " << where.value << endl;
+    }
 
     if (sql_vector.size() == pos) {
       break;
@@ -480,35 +551,41 @@ void SQLUpdate::Parse(std::vector<std::string> sql_vector) {
   pos++;
 
   while (true) {
-    SQLWhere where;
+    SQLWhere where = SQLWhere();
 
     where.key = sql_vector[pos];
     pos++;
 
-    if (sql_vector[pos] == "=") {
-      where.sign_type = SIGN_EQ;
-    } else if (sql_vector[pos] == "<") {
-      where.sign_type = SIGN_LT;
-    } else if (sql_vector[pos] == ">") {
-      where.sign_type = SIGN_GT;
-    } else if (sql_vector[pos] == "<=") {
-      where.sign_type = SIGN_LE;
-    } else if (sql_vector[pos] == ">=") {
-      where.sign_type = SIGN_GE;
-    } else if (sql_vector[pos] == "<>") {
-      where.sign_type = SIGN_NE;
-    }
-    pos++;
+    if (sql_vector[pos] == "between") {
+      pos = ParseBetween(sql_vector, wheres_, where.key, pos + 1);
+    } else {
+      if (sql_vector[pos] == "=") {
+        where.sign_type = SIGN_EQ;
+      } else if (sql_vector[pos] == "<") {
+        where.sign_type = SIGN_LT;
+      } else if (sql_vector[pos] == ">") {
+        where.sign_type = SIGN_GT;
+      } else if (sql_vector[pos] == "<=") {
+        where.sign_type = SIGN_LE;
+      } else if (sql_vector[pos] == ">=") {
+        where.sign_type = SIGN_GE;
+      } else if (sql_vector[pos] == "<>") {
+        where.sign_type = SIGN_NE;
+      } else {
+        throw SyntaxErrorException();
+      }
+      pos++;
 
-    where.value = sql_vector[pos];
-    pos++;
+      where.value = sql_vector[pos];
+      pos++;
 
-    if (where.value.at(0) == '\'' || where.value.at(0) == '\"') {
-      where.value.assign(where.value, 1, where.value.length() - 2);
-    }
+      if (where.value.at(0) == '\'' || where.value.at(0) == '\"') {
+        where.value.assign(where.value, 1, where.value.length() - 2);
+      }
 
-    wheres_.push_back(where);
-    cout << where.key << " " << where.sign_type << " " << where.value << endl;
+      wheres_.push_back(where);
+      cout << where.key << " " << where.sign_type << " " << where.value << endl;
+    }
 
     if (sql_vector.size() == pos) {
       break;
@@ -520,3 +597,64 @@ void SQLUpdate::Parse(std::vector<std::string> sql_vector) {
     pos++;
   }
 }
+
+void SQLSet::Parse(std::vector<std::string> sql_vector) {
+  sql_type_ = 120;
+  unsigned int pos = 1;
+
+  if (sql_vector.size() != pos + 3) {
+    throw SyntaxErrorException();
+  }
+
+  name_ = to_lower_copy(sql_vector[pos]);
+  std::cout << "VARIABLE: " << name_ << std::endl;
+  pos++;
+
+  if (sql_vector[pos] != "=") {
+    throw SyntaxErrorException();
+  }
+  pos++;
+
+  value_ = sql_vector[pos];
+  std::cout << "VALUE: " << value_ << std::endl;
+}
+
+// load data infile 'file_name' into table tb_name [ignore N lines]
+void SQLLoad::Parse(std::vector<std::string> sql_vector) {
+  sql_type_ = 130;
+  unsigned int pos = 1;
+  ignore_lines_ = 0;
+
+  if (sql_vector.size() < pos + 6 || to_lower_copy(sql_vector[pos]) != "data" ||
+      to_lower_copy(sql_vector[pos + 1]) != "infile") {
+    throw SyntaxErrorException();
+  }
+  pos += 2;
+
+  file_name_ = sql_vector[pos];
+  if (file_name_.length() >= 2 && (file_name_.at(0) == '\'' || file_name_.at(0) == '\"')) {
+    file_name_.assign(file_name_, 1, file_name_.length() - 2);
+  }
+  std::cout << "FILE NAME: " << file_name_ << std::endl;
+  pos++;
+
+  if (to_lower_copy(sql_vector[pos]) != "into" ||
+      to_lower_copy(sql_vector[pos + 1]) != "table") {
+    throw SyntaxErrorException();
+  }
+  pos += 2;
+
+  tb_name_ = sql_vector[pos];
+  std::cout << "TABLE NAME: " << tb_name_ << std::endl;
+  pos++;
+
+  if (pos == sql_vector.size()) {
+    return;
+  }
+  if (sql_vector.size() != pos + 3 || to_lower_copy(sql_vector[pos]) != "ignore" ||
+      to_lower_copy(sql_vector[pos + 2]) != "lines") {
+    throw SyntaxErrorException();
+  }
+  ignore_lines_ = atoi(sql_vector[pos + 1].c_str());
+  std::cout << "IGNORE LINES: " << ignore_lines_ << std::endl;
+}
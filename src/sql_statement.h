@@ -35,6 +35,18 @@ public:
     memcpy(key_, t1.key_, length_);
   }
 
+  TKey &operator=(const TKey &t1) {
+    if (this != &t1) {
+      char *key = new char[t1.length_];
+      memcpy(key, t1.key_, t1.length_);
+      delete[] key_;
+      key_ = key;
+      key_type_ = t1.key_type_;
+      length_ = t1.length_;
+    }
+    return *this;
+  }
+
   void ReadValue(const char *content) {
     switch (key_type_) {
     case 0: {
@@ -45,8 +57,8 @@ public:
       float a = std::atof(content);
       memcpy(key_, &a, length_);
     } break;
-    case 2: {
-      memcpy(key_, content, length_);
+    case 2: { // zero padded like the attribute in a record, a longer value is cut
+      strncpy(key_, content, length_);
     } break;
     }
   }
@@ -61,8 +73,8 @@ public:
       float a = std::atof(str.c_str());
       memcpy(key_, &a, length_);
     } break;
-    case 2: {
-      memcpy(key_, str.c_str(), length_);
+    case 2: { // zero padded like the attribute in a record, a longer value is cut
+      strncpy(key_, str.c_str(), length_);
     } break;
     }
   }
@@ -135,6 +147,12 @@ public:
   }
 };
 
+typedef struct {
+  std::string key;
+  int sign_type;
+  std::string value;
+} SQLWhere;
+
 class SQL {
 protected:
   int sql_type_;
@@ -148,16 +166,20 @@ public:
   virtual void Parse(std::vector<std::string> sql_vector) = 0;
   int ParseDataType(std::vector<std::string> sql_vector, Attribute &attr,
                     unsigned int pos);
+  int ParseBetween(std::vector<std::string> &sql_vector, std::vector<SQLWhere> &wheres,
+                   std::string key, unsigned int pos);
 };
 
 class SQLCreateDatabase : public SQL {
 private:
   std::string db_name_;
+  int page_size_; // PAGE_SIZE_DEFAULT unless given by PAGE_SIZE = N
 
 public:
   SQLCreateDatabase(std::vector<std::string> sql_vector) { Parse(sql_vector); }
   std::string db_name() { return db_name_; }
   void set_db_name(std::string dbname) { db_name_ = dbname; }
+  int page_size() { return page_size_; }
   void Parse(std::vector<std::string> sql_vector);
 };
 
@@ -227,13 +249,13 @@ typedef struct {
 class SQLInsert : public SQL {
 private:
   std::string tb_name_;
-  std::vector<SQLValue> values_;
+  std::vector<std::vector<SQLValue> > rows_; // one or more rows of values
 
 public:
   SQLInsert(std::vector<std::string> sql_vector) { Parse(sql_vector); }
   void Parse(std::vector<std::string> sql_vector);
   std::string tb_name() { return tb_name_; }
-  std::vector<SQLValue> &values() { return values_; }
+  std::vector<std::vector<SQLValue> > &rows() { return rows_; }
 };
 
 class SQLExec : public SQL {
@@ -246,21 +268,17 @@ public:
   std::string file_name() { return file_name_; }
 };
 
-typedef struct {
-  std::string key;
-  int sign_type;
-  std::string value;
-} SQLWhere;
-
 class SQLSelect : public SQL {
 private:
   std::string tb_name_;
+  std::vector<std::string> col_names_; // empty for *
   std::vector<SQLWhere> wheres_;
 
 public:
   SQLSelect(std::vector<std::string> sql_vector) { Parse(sql_vector); }
   void Parse(std::vector<std::string> sql_vector);
   std::string tb_name() { return tb_name_; }
+  std::vector<std::string> &col_names() { return col_names_; }
   std::vector<SQLWhere> &wheres() { return wheres_; }
 };
 
@@ -309,4 +327,30 @@ public:
   std::vector<SQLKeyValue> &keyvalues() { return keyvalues_; }
 };
 
+class SQLLoad : public SQL {
+private:
+  std::string file_name_;
+  std::string tb_name_;
+  int ignore_lines_; // the first lines of the file that are not rows, e.g. a header
+
+public:
+  SQLLoad(std::vector<std::string> sql_vector) { Parse(sql_vector); }
+  void Parse(std::vector<std::string> sql_vector);
+  std::string file_name() { return file_name_; }
+  std::string tb_name() { return tb_name_; }
+  int ignore_lines() { return ignore_lines_; }
+};
+
+class SQLSet : public SQL {
+private:
+  std::string name_;
+  std::string value_;
+
+public:
+  SQLSet(std::vector<std::string> sql_vector) { Parse(sql_vector); }
+  void Parse(std::vector<std::string> sql_vector);
+  std::string name() { return name_; }
+  std::string value() { return value_; }
+};
+
 #endif